@@ -60,7 +60,7 @@
 
 #define ph1_bits(n) ph1_bithuff(n, 0)
 #define ph1_huff(h) ph1_bithuff(*h, h + 1)
-#define getbits(n)  getbithuff(n, 0)
-#define gethuff(h)  getbithuff(*h, h + 1)
+#define getbits(n)  getbithuff_fast(n, 0)
+#define gethuff(h)  getbithuff_fast(*h, h + 1)
 
 #endif
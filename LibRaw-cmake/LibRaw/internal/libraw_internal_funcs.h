@@ -152,11 +152,67 @@ it under the terms of the one of two licenses as you choose:
 
 // LJPEG decoder
 	unsigned    getbithuff (int nbits, ushort *huff);
+	/* getbithuff() when the bytes needed are already in bitbuf */
+	unsigned    getbithuff_fast (int nbits, ushort *huff)
+	{
+		int vbits = tls->getbits.vbits, ahead = tls->getbits.ahead;
+		int need = vbits < nbits ? (nbits - vbits + 7) >> 3 : 0;
+		if (nbits <= 0 || nbits > 25 || vbits < 0 || need > ahead ||
+		    (need && tls->getbits.reset))
+			return getbithuff(nbits, huff);
+		ahead -= need;
+		vbits += need * 8;
+		unsigned c = unsigned(tls->getbits.bitbuf << (64 - vbits - 8 * ahead) >> (64 - nbits));
+		if (huff)
+		{
+			vbits -= huff[c] >> 8;
+			c = (uchar)huff[c];
+		}
+		else
+			vbits -= nbits;
+		tls->getbits.vbits = vbits;
+		tls->getbits.ahead = ahead;
+		if (vbits < 0)
+			derror();
+		return c;
+	}
+	int         getbits_fill();
+	void        getbits_settle();
+	void        getbits_sync() { if (tls->getbits.stream) getbits_settle(); }
 	ushort*     make_decoder_ref (const uchar **source);
 	ushort*     make_decoder (const uchar *source);
+	void        make_lookahead (const ushort *huff, int *fast, int nikon);
+	/* make_decoder_ref() stores a make_lookahead() table after the decoder */
+	int*        decoder_lookahead (ushort *huff) { return huff ? (int *)(huff + ((2 + (1 << huff[0])) & ~1)) : 0; }
+	/* code and difference bits in one step when both are already in bitbuf */
+	int         lookahead_diff (const ushort *huff, const int *fast, int *diff)
+	{
+		int vbits = tls->getbits.vbits, ahead = tls->getbits.ahead;
+		if (!huff || !fast)
+			return 0;
+		int max = huff[0], need = vbits < max ? (max - vbits + 7) >> 3 : 0;
+		if (max <= 0 || vbits < 0 || need > ahead ||
+		    (need && tls->getbits.reset))
+			return 0;
+		ahead -= need;
+		vbits += need * 8;
+		unsigned c = unsigned(tls->getbits.bitbuf << (64 - vbits - 8 * ahead) >> (64 - max));
+		int e = fast[1 + (c >> fast[0])];
+		if ((e & 63) == 63)
+			return 0;
+		tls->getbits.vbits = vbits - (e & 63);
+		tls->getbits.ahead = ahead;
+		*diff = e >> 6;
+		return 1;
+	}
 	int         ljpeg_start (struct jhead *jh, int info_only);
 	void        ljpeg_end(struct jhead *jh);
 	int         ljpeg_diff (ushort *huff);
+	int         ljpeg_diff_fast (ushort *huff, const int *fast)
+	{
+		int diff;
+		return lookahead_diff(huff, fast, &diff) ? diff : ljpeg_diff(huff);
+	}
 	ushort *    ljpeg_row (int jrow, struct jhead *jh);
 	ushort *    ljpeg_row_unrolled (int jrow, struct jhead *jh);
 	void	    ljpeg_idct (struct jhead *jh);
@@ -167,15 +223,22 @@ it under the terms of the one of two licenses as you choose:
 	int         canon_has_lowbits();
 	void        canon_load_raw();
 	void        lossless_jpeg_load_raw();
+	int         lossless_jpeg_row_fits(int jrow, int jwide);
+	void        lossless_jpeg_remap(const ushort *src, int jrow0, int nrows, int jwide);
 	void        canon_sraw_load_raw();
 // Adobe DNG
 	void        adobe_copy_pixel (unsigned int row, unsigned int col, ushort **rp);
 	void        lossless_dng_load_raw();
+	int         lossless_dng_tile_fits(struct jhead *jh);
+	int         lossless_dng_tile(LibRaw *dec, unsigned trow, unsigned tcol, void *);
+	int         dng_tiles_parallel(int (LibRaw::*tile)(LibRaw *, unsigned, unsigned, void *), void *data);
 	void        deflate_dng_load_raw();
 	void        packed_dng_load_raw();
     void        packed_tiled_dng_load_raw();
     void        uncompressed_fp_dng_load_raw();
+    void        fp_dng_swap_row(uchar *data, int len, int bytesps, bool difford);
 	void        lossy_dng_load_raw();
+	int         lossy_dng_tile(LibRaw *dec, unsigned trow, unsigned tcol, void *data);
 //void        adobe_dng_load_raw_nc();
 
 // Pentax
@@ -186,6 +249,7 @@ it under the terms of the one of two licenses as you choose:
 
 // Nikon (and Minolta Z2)
 	void        nikon_load_raw();
+	void        nikon_apply_curve(ushort *from, ushort *to);
     void        nikon_he_load_raw_placeholder();
 	void        nikon_read_curve();
 	void        nikon_load_striped_packed_raw();
@@ -221,12 +285,14 @@ it under the terms of the one of two licenses as you choose:
 //int         bayer (unsigned row, unsigned col);
 	int         p1raw(unsigned,unsigned);
 	void        phase_one_flat_field (int is_float, int nc);
+	void        phase_one_apply_curve(unsigned row0, unsigned row1, unsigned col0, unsigned col1);
 	int 	    p1rawc(unsigned row, unsigned col, unsigned& count);
 	void 	    phase_one_fix_col_pixel_avg(unsigned row, unsigned col);
 	void 	    phase_one_fix_pixel_grad(unsigned row, unsigned col);
 	void        phase_one_load_raw();
 	unsigned    ph1_bits (int nbits);
 	void        phase_one_load_raw_c();
+	int         phase_one_c_row(uchar *src, ushort *pixel, int len[2]);
     void		phase_one_load_raw_s();
 	void        hasselblad_load_raw();
 	void        leaf_hdr_load_raw();
@@ -253,6 +319,7 @@ it under the terms of the one of two licenses as you choose:
 #endif
 	unsigned    pana_data (int nb, unsigned *bytes);
 	void        panasonic_load_raw();
+	int         panasonic5_load_raw_parallel();
 //	void        panasonic_16x10_load_raw();
 	void        olympus_load_raw();
 //	void        olympus_cseries_load_raw();
@@ -291,6 +358,7 @@ it under the terms of the one of two licenses as you choose:
 	void        sony_load_raw();
 	void        sony_arw_load_raw();
 	void        sony_arw2_load_raw();
+	void        sony_arw2_row(uchar *data, int row);
 	void        sony_arq_load_raw();
 	void        sony_ljpeg_load_raw();
 	void        samsung_load_raw();
@@ -370,6 +438,9 @@ it under the terms of the one of two licenses as you choose:
 	void ahd_interpolate_build_homogeneity_map(int top, int left, short (*lab)[LIBRAW_AHD_TILE][LIBRAW_AHD_TILE][3], char (*out_homogeneity_map)[LIBRAW_AHD_TILE][2]);
 	void ahd_interpolate_combine_homogeneous_pixels(int top, int left, ushort (*rgb)[LIBRAW_AHD_TILE][LIBRAW_AHD_TILE][3], char (*homogeneity_map)[LIBRAW_AHD_TILE][2]);
 
+// split VNG code
+	void vng_interpolate_row(int row, int *code[16][16], int prow, int pcol, ushort (*brow)[4]);
+
 	void init_fuji_compr(struct fuji_compressed_params* info);
 	void init_fuji_block(struct fuji_compressed_block* info, const struct fuji_compressed_params *params, INT64 raw_offset, unsigned dsize);
 	void copy_line_to_xtrans(struct fuji_compressed_block* info, int cur_line, int cur_block, int cur_block_width);
@@ -381,6 +452,7 @@ it under the terms of the one of two licenses as you choose:
 	void parse_fuji_compressed_header();
 	void crxLoadRaw();
 	int  crxParseImageHeader(uchar *cmp1TagData, int nTrack, int size);
+	int panasonicC_band(int rowbytes, int rows);
 	void panasonicC6_load_raw();
 	void panasonicC7_load_raw();
 
@@ -196,20 +196,21 @@ it under the terms of the one of two licenses as you choose:
 
 
 #ifdef LIBRAW_IO_REDEFINED
-#define fread(ptr,size,n,stream)   stream->read(ptr,size,n)
-#define fseek(stream,o,w)          stream->seek(o,w)
-#define fseeko(stream,o,w)         stream->seek(o,w)
-#define ftell(stream)              stream->tell()
-#define ftello(stream)             stream->tell()
-#define feof(stream)               stream->eof()
+/* getbits_sync() hands bytes read ahead by getbithuff() back to the stream */
+#define fread(ptr,size,n,stream)   (getbits_sync(), stream->read(ptr,size,n))
+#define fseek(stream,o,w)          (getbits_sync(), stream->seek(o,w))
+#define fseeko(stream,o,w)         (getbits_sync(), stream->seek(o,w))
+#define ftell(stream)              (getbits_sync(), stream->tell())
+#define ftello(stream)             (getbits_sync(), stream->tell())
+#define feof(stream)               (getbits_sync(), stream->eof())
 #ifdef getc
 #undef getc
 #endif
-#define getc(stream)               stream->get_char()
-#define fgetc(stream)              stream->get_char()
-#define fgetcb(stream)             stream->get_char_buf()
-#define fgets(str,n,stream)        stream->gets(str,n)
-#define fscanf(stream,fmt,ptr)     stream->scanf_one(fmt,ptr)
+#define getc(stream)               (getbits_sync(), stream->get_char())
+#define fgetc(stream)              (getbits_sync(), stream->get_char())
+#define fgetcb(stream)             (getbits_sync(), stream->get_char_buf())
+#define fgets(str,n,stream)        (getbits_sync(), stream->gets(str,n))
+#define fscanf(stream,fmt,ptr)     (getbits_sync(), stream->scanf_one(fmt,ptr))
 #endif
 
 #endif
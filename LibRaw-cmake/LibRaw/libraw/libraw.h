@@ -116,6 +116,8 @@ extern "C"
                                unsigned unused_bits, unsigned otherflags,
                                unsigned black_level);
   DllDef int libraw_unpack(libraw_data_t *);
+  DllDef int libraw_unpack_roi(libraw_data_t *, int left, int top, int width,
+                               int height);
   DllDef int libraw_unpack_thumb(libraw_data_t *);
   DllDef int libraw_unpack_thumb_ex(libraw_data_t *,int);
   DllDef void libraw_recycle_datastream(libraw_data_t *);
@@ -139,9 +141,12 @@ extern "C"
                                            void *datap);
   DllDef void libraw_set_progress_handler(libraw_data_t *, progress_callback cb,
                                           void *datap);
+  DllDef void libraw_set_rawband_handler(libraw_data_t *, rawband_callback cb,
+                                         void *datap);
   DllDef const char *libraw_unpack_function_name(libraw_data_t *lr);
   DllDef int libraw_get_decoder_info(libraw_data_t *lr,
                                      libraw_decoder_info_t *d);
+  DllDef int libraw_get_memstats(libraw_data_t *lr, libraw_memstats_t *m);
   DllDef int libraw_COLOR(libraw_data_t *, int row, int col);
   DllDef unsigned libraw_capabilities();
 
@@ -155,6 +160,11 @@ extern "C"
   libraw_dcraw_make_mem_image(libraw_data_t *lr, int *errc);
   DllDef libraw_processed_image_t *
   libraw_dcraw_make_mem_thumb(libraw_data_t *lr, int *errc);
+  DllDef libraw_processed_image_t *
+  libraw_dcraw_make_half_image(libraw_data_t *lr, int *errc);
+  DllDef libraw_processed_image_t *libraw_raw_bin(libraw_data_t *lr,
+                                                  int factor, int bits,
+                                                  int *errc);
   DllDef void libraw_dcraw_clear_mem(libraw_processed_image_t *);
   /* getters/setters used by 3DLut Creator */
   DllDef void libraw_set_demosaic(libraw_data_t *lr, int value);
@@ -219,6 +229,9 @@ public:
   int error_count() { return libraw_internal_data.unpacker_data.data_error; }
   void recycle_datastream();
   int unpack(void);
+  /* unpack() decoding (visible area) rectangle only if decoder supports it.
+     Pixels outside are zero */
+  int unpack_roi(int left, int top, int width, int height);
   int unpack_thumb(void);
   int unpack_thumb_ex(int);
   int thumbOK(INT64 maxsz = -1);
@@ -246,6 +259,12 @@ public:
     callbacks.progresscb_data = data;
     callbacks.progress_cb = pcb;
   }
+  /* Called by unpack() with completed raw_image row bands, top to bottom */
+  void set_rawband_handler(rawband_callback rcb, void *data)
+  {
+    callbacks.rawbandcb_data = data;
+    callbacks.rawband_cb = rcb;
+  }
 
   static const char* cameramakeridx2maker(unsigned maker);
   int setMakeFromIndex(unsigned index);
@@ -279,12 +298,18 @@ public:
   /* memory writers */
   virtual libraw_processed_image_t *dcraw_make_mem_image(int *errcode = NULL);
   virtual libraw_processed_image_t *dcraw_make_mem_thumb(int *errcode = NULL);
+  virtual libraw_processed_image_t *dcraw_make_half_image(int *errcode = NULL);
+  /* factor x factor CFA block averages, camera RGB without white balance,
+     0..1 of white level; bits = 16 (ushort) or 32 (float) */
+  virtual libraw_processed_image_t *raw_bin(int factor, int bits = 16,
+                                            int *errcode = NULL);
   static void dcraw_clear_mem(libraw_processed_image_t *);
 
   /* Additional calls for make_mem_image */
   void get_mem_image_format(int *width, int *height, int *colors,
                             int *bps) const;
   int copy_mem_image(void *scan0, int stride, int bgr);
+  int half_image_supported();
 
   /* free all internal data structures */
   void recycle();
@@ -309,6 +334,7 @@ public:
 
   const char *unpack_function_name();
   virtual int get_decoder_info(libraw_decoder_info_t *d_info);
+  int get_memstats(libraw_memstats_t *m);
   libraw_internal_data_t *get_internal_data_pointer()
   {
     return &libraw_internal_data;
@@ -375,9 +401,11 @@ protected:
                          int cur_block, INT64 raw_offset, unsigned size, uchar *q_bases);
   /* CR3 decoder public interface to make parallel decoder */
   virtual void crxLoadDecodeLoop(void *, int);
+  virtual void crxLoadDecodeBands(void *, int);
   int crxDecodePlane(void *, uint32_t planeNumber);
   virtual void crxLoadFinalizeLoopE3(void *, int);
   void crxConvertPlaneLineDf(void *, int);
+  void crxFreeArena();
 
   int FCF(int row, int col)
   {
@@ -398,6 +426,10 @@ protected:
   }
 
   void adjust_bl();
+  /* rawband callback helpers */
+  int rawband_height();
+  void rawband_send(ushort *band, int row, int nrows);
+  void rawband_flush(int rows_done, int final);
   void *malloc(size_t t);
   void *calloc(size_t n, size_t t);
   void *realloc(void *p, size_t s);
@@ -431,6 +463,16 @@ protected:
                                 char **list);
   void write_ppm_tiff();
   void convert_to_rgb();
+  void convert_to_rgb_matrix(float out_cam[3][4]);
+  void half_image_gather(int hrow, ushort (*quad)[4], const int cblk[4],
+                         ushort *dmaxp);
+  void half_image_render(ushort (*quad)[4], int count,
+                         const float scale_mul[4], float out_cam[3][4],
+                         int (*hist)[LIBRAW_HISTOGRAM_SIZE]);
+  void half_image_emit(ushort (*quad)[4], int hrow,
+                       libraw_processed_image_t *img);
+  void raw_bin_row(int brow, int factor, INT64 (*sum)[6],
+                   libraw_processed_image_t *img);
   void remove_zeroes();
   void crop_masked_pixels();
 #ifndef NO_LCMS
@@ -442,6 +484,7 @@ protected:
   void vng_interpolate();
   void ppg_interpolate();
   void cielab(ushort rgb[3], short lab[3]);
+  void cielab_row(ushort (*rgb)[3], short (*lab)[3], int count);
   void xtrans_interpolate(int);
   void ahd_interpolate();
   void dht_interpolate();
@@ -454,8 +497,13 @@ protected:
   void bad_pixels(const char *);
   void subtract(const char *);
   void hat_transform(float *temp, float *base, int st, int size, int sc);
+  void hat_transform_row(float *out, float *base, int size, int sc);
+  void hat_transform_cols(float *base, int st, int size, int sc, int cols,
+                          float *ring);
   void wavelet_denoise();
   void scale_colors();
+  void scale_colors_wb();
+  void scale_colors_mul(float scale_mul[4]);
   void median_filter();
   void blend_highlights();
   void recover_highlights();
@@ -496,6 +544,8 @@ protected:
   int try_dngsdk();
   /* X3F data */
   void *_x3f_data; /* keep it even if USE_X3FTOOLS is not defined to do not change sizeof(LibRaw)*/
+  /* CR3 decoder buffers, kept between files */
+  void *_crx_arena;
 
   int raw_was_read()
   {
@@ -26,120 +26,378 @@ it under the terms of the one of two licenses as you choose:
 #ifdef __cplusplus
 
 #define LIBRAW_MSIZE 512
+/* pointer table size, power of 2, at least twice LIBRAW_MSIZE */
+#define LIBRAW_MTABLE_SIZE 1024
+/* arena backend: chunk size, largest block taken from the arena and
+   number of chunks after which blocks come from the heap again */
+#define LIBRAW_MARENA_CHUNK (1024 * 1024)
+#define LIBRAW_MARENA_MAXBLOCK (64 * 1024)
+#define LIBRAW_MARENA_MAXCHUNKS 64
+/* retain(): max. number of kept blocks and smallest request served by them */
+#define LIBRAW_MKEEP_COUNT 8
+#define LIBRAW_MKEEP_MINBLOCK (256 * 1024)
 
 class DllDef libraw_memmgr
 {
 public:
-  libraw_memmgr(unsigned ee) : extra_bytes(ee)
+  libraw_memmgr(unsigned ee)
+      : extra_bytes(ee), nmems(0), arena(0), arena_cur(0), arena_last(0),
+        arena_pos(0), arena_chunks(0),
+        use_arena(0), cur_bytes(0), peak_bytes(0), nallocs(0), nkept(0),
+        kept_bytes(0)
   {
-    size_t alloc_sz = LIBRAW_MSIZE * sizeof(void *);
-    mems = (void **)::malloc(alloc_sz);
+    size_t alloc_sz = LIBRAW_MTABLE_SIZE * sizeof(*mems);
+    mems = (memrec *)::malloc(alloc_sz);
     memset(mems, 0, alloc_sz);
   }
   ~libraw_memmgr()
   {
     cleanup();
     ::free(mems);
+    for (int i = 0; i < nkept; i++)
+      ::free(kept[i].ptr);
+    while (arena)
+    {
+      arena_chunk *next = arena->next;
+      ::free(arena);
+      arena = next;
+    }
   }
+  /* small blocks are taken from arena chunks: free() does not release
+     memory, cleanup() resets all chunks at once. Usage thus only grows
+     until cleanup(), up to LIBRAW_MARENA_MAXCHUNKS chunks */
+  void set_arena(int on) { use_arena = on; }
   void *malloc(size_t sz)
   {
+    void *ptr = arena_alloc(sz + extra_bytes);
+    if (ptr || (ptr = take_kept(sz + extra_bytes)))
+    {
 #ifdef LIBRAW_USE_CALLOC_INSTEAD_OF_MALLOC
-    void *ptr = ::calloc(sz + extra_bytes, 1);
+      memset(ptr, 0, sz + extra_bytes);
+#endif
+      return ptr;
+    }
+#ifdef LIBRAW_USE_CALLOC_INSTEAD_OF_MALLOC
+    ptr = ::calloc(sz + extra_bytes, 1);
 #else
-    void *ptr = ::malloc(sz + extra_bytes);
+    ptr = ::malloc(sz + extra_bytes);
 #endif
-    mem_ptr(ptr);
+    mem_ptr(ptr, sz + extra_bytes, 0);
     return ptr;
   }
   void *calloc(size_t n, size_t sz)
   {
-    void *ptr = ::calloc(n + (extra_bytes + sz - 1) / (sz ? sz : 1), sz);
-    mem_ptr(ptr);
+    size_t nn = n + (extra_bytes + sz - 1) / (sz ? sz : 1);
+    void *ptr = arena_alloc(nn * sz);
+    if (ptr)
+    {
+      memset(ptr, 0, nn * sz);
+      return ptr;
+    }
+    if ((ptr = take_kept(nn * sz)))
+    {
+      memset(ptr, 0, nn * sz);
+      return ptr;
+    }
+    ptr = ::calloc(nn, sz);
+    mem_ptr(ptr, nn * sz, 0);
     return ptr;
   }
   void *realloc(void *ptr, size_t newsz)
   {
+    size_t oldsz;
+    int inarena = 0;
+    if (ptr && find_ptr(ptr, &oldsz, &inarena) && inarena)
+    {
+      void *ret = malloc(newsz);
+      if (ret)
+      {
+        memmove(ret, ptr, oldsz < newsz + extra_bytes ? oldsz : newsz + extra_bytes);
+        forget_ptr(ptr);
+      }
+      return ret;
+    }
     void *ret = ::realloc(ptr, newsz + extra_bytes);
-    forget_ptr(ptr);
-    mem_ptr(ret);
+    if (ret || !newsz)
+      forget_ptr(ptr);
+    mem_ptr(ret, newsz + extra_bytes, 0);
     return ret;
   }
   void free(void *ptr)
   {
-    forget_ptr(ptr);
-    ::free(ptr);
+    if (!forget_ptr(ptr))
+      ::free(ptr);
   }
   void cleanup(void)
   {
-    for (int i = 0; i < LIBRAW_MSIZE; i++)
-      if (mems[i])
+#if defined(LIBRAW_USE_OPENMP)
+#pragma omp critical
+    {
+#endif
+    for (int i = 0; i < LIBRAW_MTABLE_SIZE; i++)
+      if (mems[i].ptr)
       {
-        ::free(mems[i]);
-        mems[i] = NULL;
+        if (!mems[i].inarena)
+          ::free(mems[i].ptr);
+        mems[i].ptr = NULL;
       }
+    nmems = 0;
+    arena_cur = arena;
+    arena_pos = 0;
+    cur_bytes = peak_bytes = 0;
+#if defined(LIBRAW_USE_OPENMP)
+    }
+#endif
   }
+  /* free() replacement: keep the block for reuse by malloc()/calloc() of
+     similar size. Oldest blocks are freed if more than maxkeep bytes kept */
+  void retain(void *ptr, size_t maxkeep)
+  {
+    size_t sz;
+    int inarena;
+    if (!ptr)
+      return;
+    if (!find_ptr(ptr, &sz, &inarena) || inarena || sz < LIBRAW_MKEEP_MINBLOCK ||
+        sz > maxkeep)
+    {
+      free(ptr);
+      return;
+    }
+    forget_ptr(ptr);
+#if defined(LIBRAW_USE_OPENMP)
+#pragma omp critical
+    {
+#endif
+    if (nkept == LIBRAW_MKEEP_COUNT || kept_bytes + sz > maxkeep)
+    {
+      int n = 0;
+      size_t freed = 0;
+      while (n < nkept && (n < nkept + 1 - LIBRAW_MKEEP_COUNT ||
+                           kept_bytes - freed + sz > maxkeep))
+      {
+        freed += kept[n].size;
+        ::free(kept[n++].ptr);
+      }
+      memmove(kept, kept + n, (nkept - n) * sizeof(kept[0]));
+      nkept -= n;
+      kept_bytes -= freed;
+    }
+    kept[nkept].ptr = ptr;
+    kept[nkept].size = sz;
+    kept[nkept].inarena = 0;
+    nkept++;
+    kept_bytes += sz;
+#if defined(LIBRAW_USE_OPENMP)
+    }
+#endif
+  }
+  /* counters: bytes in use, max. bytes in use since cleanup(), number of
+     allocations made */
+  size_t current_bytes() { return cur_bytes; }
+  size_t max_bytes() { return peak_bytes; }
+  size_t allocations() { return nallocs; }
 
 private:
-  void **mems;
+  struct memrec
+  {
+    void *ptr;
+    size_t size;
+    int inarena;
+  };
+  struct arena_chunk
+  {
+    arena_chunk *next;
+    size_t size;
+  };
+  memrec *mems; /* open addressing, linear probing */
   unsigned extra_bytes;
-  void mem_ptr(void *ptr)
+  int nmems;
+  arena_chunk *arena, *arena_cur, *arena_last; /* oldest first */
+  size_t arena_pos;
+  int arena_chunks;
+  int use_arena;
+  size_t cur_bytes, peak_bytes, nallocs;
+  memrec kept[LIBRAW_MKEEP_COUNT]; /* retain()-ed blocks, oldest first */
+  int nkept;
+  size_t kept_bytes;
+
+  static unsigned slot(void *ptr)
+  {
+    size_t h = (size_t)ptr >> 4;
+    return unsigned((h * 2654435761U) ^ (h >> 15)) & (LIBRAW_MTABLE_SIZE - 1);
+  }
+  static size_t chunk_hdr() { return (sizeof(arena_chunk) + 15) & ~size_t(15); }
+  void *arena_alloc(size_t sz)
   {
+    if (!use_arena || sz > LIBRAW_MARENA_MAXBLOCK)
+      return NULL;
+    void *ptr = NULL;
+    sz = (sz + 15) & ~size_t(15);
 #if defined(LIBRAW_USE_OPENMP)
-      bool ok = false; /* do not return from critical section */
+#pragma omp critical
+    {
 #endif
-
+    if (nmems < LIBRAW_MSIZE - 1) /* do not take untracked blocks */
+    {
+      while (arena_cur && arena_pos + sz > arena_cur->size)
+      {
+        arena_cur = arena_cur->next;
+        arena_pos = 0;
+      }
+      /* chunks are appended, so the ones passed above stay behind */
+      if (!arena_cur && arena_chunks < LIBRAW_MARENA_MAXCHUNKS)
+      {
+        arena_chunk *c = (arena_chunk *)::malloc(chunk_hdr() + LIBRAW_MARENA_CHUNK);
+        if (c)
+        {
+          c->size = LIBRAW_MARENA_CHUNK;
+          c->next = NULL;
+          if (arena_last)
+            arena_last->next = c;
+          else
+            arena = c;
+          arena_last = arena_cur = c;
+          arena_pos = 0;
+          arena_chunks++;
+        }
+      }
+      if (arena_cur)
+      {
+        ptr = (char *)arena_cur + chunk_hdr() + arena_pos;
+        arena_pos += sz;
+        add_ptr(ptr, sz, 1);
+      }
+    }
+#if defined(LIBRAW_USE_OPENMP)
+    }
+#endif
+    return ptr;
+  }
+  /* smallest kept block fitting sz, not more than twice larger */
+  void *take_kept(size_t sz)
+  {
+    void *ptr = NULL;
+    if (!nkept || sz < LIBRAW_MKEEP_MINBLOCK)
+      return NULL;
 #if defined(LIBRAW_USE_OPENMP)
 #pragma omp critical
-      {
+    {
 #endif
-          if (ptr)
-          {
-              for (int i = 0; i < LIBRAW_MSIZE - 1; i++)
-                  if (!mems[i])
-                  {
-                      mems[i] = ptr;
+    int best = -1;
+    for (int i = 0; i < nkept; i++)
+      if (kept[i].size >= sz && kept[i].size / 2 <= sz &&
+          (best < 0 || kept[i].size < kept[best].size))
+        best = i;
+    if (best >= 0 && nmems < LIBRAW_MSIZE - 1)
+    {
+      ptr = kept[best].ptr;
+      add_ptr(ptr, kept[best].size, 0);
+      kept_bytes -= kept[best].size;
+      memmove(kept + best, kept + best + 1, (nkept - best - 1) * sizeof(kept[0]));
+      nkept--;
+    }
 #if defined(LIBRAW_USE_OPENMP)
-		      ok = true;
-		      break;
-#else
-                      return;
+    }
 #endif
-                  }
-#ifdef LIBRAW_MEMPOOL_CHECK
-#if !defined(LIBRAW_USE_OPENMP)
-              /* remember ptr in last mems item to be free'ed at cleanup */
-              if (!mems[LIBRAW_MSIZE - 1])
-                  mems[LIBRAW_MSIZE - 1] = ptr;
-              throw LIBRAW_EXCEPTION_MEMPOOL;
+    return ptr;
+  }
+  void add_ptr(void *ptr, size_t sz, int inarena)
+  {
+    unsigned i = slot(ptr);
+    while (mems[i].ptr)
+      i = (i + 1) & (LIBRAW_MTABLE_SIZE - 1);
+    mems[i].ptr = ptr;
+    mems[i].size = sz;
+    mems[i].inarena = inarena;
+    nmems++;
+    nallocs++;
+    cur_bytes += sz;
+    if (cur_bytes > peak_bytes)
+      peak_bytes = cur_bytes;
+  }
+  void mem_ptr(void *ptr, size_t sz, int inarena)
+  {
+    if (!ptr)
+      return;
+    bool ok = false; /* do not return from critical section */
+#if defined(LIBRAW_USE_OPENMP)
+#pragma omp critical
+    {
+#endif
+    if (nmems < LIBRAW_MSIZE - 1)
+    {
+      add_ptr(ptr, sz, inarena);
+      ok = true;
+    }
+#if defined(LIBRAW_USE_OPENMP)
+    }
 #endif
+#if defined(LIBRAW_MEMPOOL_CHECK) || defined(LIBRAW_USE_OPENMP)
+    if (!ok)
+    {
+      ::free(ptr);
+      throw LIBRAW_EXCEPTION_MEMPOOL;
+    }
 #endif
-          }
+  }
+  bool find_ptr(void *ptr, size_t *sz, int *inarena)
+  {
+    bool found = false;
 #if defined(LIBRAW_USE_OPENMP)
-      }
-      if(!ok)
+#pragma omp critical
+    {
+#endif
+    for (unsigned i = slot(ptr); mems[i].ptr; i = (i + 1) & (LIBRAW_MTABLE_SIZE - 1))
+      if (mems[i].ptr == ptr)
       {
-          if (!mems[LIBRAW_MSIZE - 1])
-              mems[LIBRAW_MSIZE - 1] = ptr;
-          throw LIBRAW_EXCEPTION_MEMPOOL;
+        *sz = mems[i].size;
+        *inarena = mems[i].inarena;
+        found = true;
+        break;
       }
+#if defined(LIBRAW_USE_OPENMP)
+    }
 #endif
+    return found;
   }
-  void forget_ptr(void *ptr)
+  /* returns non-zero for arena blocks (nothing to free) */
+  int forget_ptr(void *ptr)
   {
+    int inarena = 0;
+    if (!ptr)
+      return 0;
 #if defined(LIBRAW_USE_OPENMP)
 #pragma omp critical
     {
 #endif
-     if (ptr)
-      for (int i = 0; i < LIBRAW_MSIZE; i++)
-        if (mems[i] == ptr)
-        {
-          mems[i] = NULL;
+    unsigned i = slot(ptr);
+    while (mems[i].ptr && mems[i].ptr != ptr)
+      i = (i + 1) & (LIBRAW_MTABLE_SIZE - 1);
+    if (mems[i].ptr)
+    {
+      inarena = mems[i].inarena;
+      cur_bytes -= mems[i].size;
+      nmems--;
+      /* backward shift deletion keeps probe chains intact */
+      unsigned j = i;
+      for (;;)
+      {
+        j = (j + 1) & (LIBRAW_MTABLE_SIZE - 1);
+        if (!mems[j].ptr)
           break;
+        unsigned k = slot(mems[j].ptr);
+        if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j)))
+        {
+          mems[i] = mems[j];
+          i = j;
         }
+      }
+      mems[i].ptr = NULL;
+    }
 #if defined(LIBRAW_USE_OPENMP)
     }
 #endif
+    return inarena;
   }
 };
 
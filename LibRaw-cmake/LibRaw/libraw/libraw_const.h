@@ -50,9 +50,6 @@ it under the terms of the one of two licenses as you choose:
 #ifndef LIBRAW_NO_IOSPACE_CHECK
 #define LIBRAW_IOSPACE_CHECK
 #endif
-#ifndef LIBRAW_NO_CR3_MEMPOOL
-#define LIBRAW_CR3_MEMPOOL
-#endif
 
 
 
@@ -73,6 +70,24 @@ LIBRAW_MEMPOOL_CHECK define will result in error on pool overflow */
 #define LIBRAW_AFDATA_MAXCOUNT 4
 
 #define LIBRAW_AHD_TILE 512
+/* rows per band in parallel VNG interpolation */
+#define LIBRAW_VNG_BAND 64
+/* columns per strip in the vertical wavelet_denoise() pass */
+#define LIBRAW_WAVELET_STRIP 64
+/* getbithuff() read-ahead window: starts small after each stream
+   reposition and doubles while the reads stay sequential */
+#define LIBRAW_GETBITS_MINWINDOW 256
+#define LIBRAW_GETBITS_MAXWINDOW 65536
+/* bits resolved at once (code plus difference bits) by the Huffman
+   lookahead tables of make_lookahead() */
+#define LIBRAW_HUFF_LOOKAHEAD 12
+/* jrows decoded by lossless_jpeg_load_raw() before each parallel store */
+#define LIBRAW_LJPEG_BAND 64
+/* rows read at once by the parallel Sony ARW2, Panasonic, Nikon and
+   floating point DNG decoders; a multiple of 16 */
+#define LIBRAW_RAW_BAND 128
+/* default band height (in raw rows) for rawband callback */
+#define LIBRAW_RAWBAND_DEFAULT_ROWS 64
 
 #ifndef LIBRAW_NO_IOSTREAMS_DATASTREAM
 
@@ -639,7 +654,10 @@ enum LibRaw_processing_options
   LIBRAW_RAWOPTIONS_DNG_STAGE2_IFPRESENT = 1 << 20,
   LIBRAW_RAWOPTIONS_DNG_STAGE3_IFPRESENT = 1 << 21,
   LIBRAW_RAWOPTIONS_DNG_ADD_MASKS = 1 << 22,
-  LIBRAW_RAWOPTIONS_CANON_IGNORE_MAKERNOTES_ROTATION = 1 << 23
+  LIBRAW_RAWOPTIONS_CANON_IGNORE_MAKERNOTES_ROTATION = 1 << 23,
+  /* rawband callback only, raw_image is not kept after unpack(); masked
+     area black levels are not calculated */
+  LIBRAW_RAWOPTIONS_RAWBAND_RING = 1 << 24
 };
 
 enum LibRaw_decoder_flags
@@ -657,7 +675,9 @@ enum LibRaw_decoder_flags
   LIBRAW_DECODER_FLAT_BG2_SWAPPED = 1<<13,
   LIBRAW_DECODER_UNSUPPORTED_FORMAT = 1 << 14,
   LIBRAW_DECODER_NOTSET = 1 << 15,
-  LIBRAW_DECODER_TRYRAWSPEED3 = 1 << 16
+  LIBRAW_DECODER_TRYRAWSPEED3 = 1 << 16,
+  LIBRAW_DECODER_RAWBANDS = 1 << 17,
+  LIBRAW_DECODER_RAWBANDRING = 1 << 18
 };
 
 #define LIBRAW_XTRANS 9
@@ -666,6 +686,8 @@ enum LibRaw_constructor_flags
 {
   LIBRAW_OPTIONS_NONE = 0,
   LIBRAW_OPTIONS_NO_DATAERR_CALLBACK = 1 << 1,
+  /* small allocations from memory arena, released all at once by recycle() */
+  LIBRAW_OPTIONS_MEMARENA = 1 << 2,
   /* Compatibility w/ years old typo */
   LIBRAW_OPIONS_NO_DATAERR_CALLBACK = LIBRAW_OPTIONS_NO_DATAERR_CALLBACK
 };
@@ -100,6 +100,13 @@ public:
 #endif
   virtual int jpeg_src(void *);
   virtual void buffering_off() {}
+  /* positional read: seek() + read() unless reimplemented. If
+   * read_at_parallel() returns non-zero, current position is not used and
+   * read_at() may be called from several threads at once */
+  virtual int read_at(void *ptr, size_t size, INT64 offset);
+  virtual int read_at_parallel() { return 0; }
+  /* hint: data at offset will be read soon */
+  virtual void read_ahead(INT64, size_t) {}
   /* reimplement in subclass to use parallel access in xtrans_load_raw() if
    * OpenMP is not used */
   virtual int lock() { return 1; } /* success */
@@ -271,6 +278,8 @@ public:
 #endif
   virtual int jpeg_src(void *jpegdata);
   virtual int read(void *ptr, size_t sz, size_t nmemb);
+  virtual int read_at(void *ptr, size_t size, INT64 offset);
+  virtual int read_at_parallel() { return 1; }
   virtual int eof();
   virtual int seek(INT64 o, int whence);
   virtual INT64 tell();
@@ -302,6 +311,12 @@ public:
 #endif
 
   virtual int read(void *ptr, size_t size, size_t nmemb);
+#ifndef LIBRAW_WIN32_CALLS
+  /* pread(), does not touch FILE position */
+  virtual int read_at(void *ptr, size_t size, INT64 offset);
+  virtual int read_at_parallel() { return 1; }
+  virtual void read_ahead(INT64 offset, size_t size);
+#endif
   virtual int eof();
   virtual int seek(INT64 o, int whence);
   virtual INT64 tell();
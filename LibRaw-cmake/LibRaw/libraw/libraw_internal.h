@@ -25,14 +25,21 @@ it under the terms of the one of two licenses as you choose:
 
 #include "libraw_datastream.h"
 #include "libraw_types.h"
+#include "libraw_const.h"
 
 class LibRaw_TLS
 {
 public:
   struct
   {
-    unsigned bitbuf;
-    int vbits, reset;
+    UINT64 bitbuf;
+    int vbits, reset, ahead;
+    /* read-ahead window over the input stream, see getbits_fill() */
+    LibRaw_abstract_datastream *stream;
+    INT64 fill_end;
+    const uchar *ptr, *end;
+    int wsize, filled;
+    uchar window[LIBRAW_GETBITS_MAXWINDOW];
   } getbits;
   struct
   {
@@ -57,7 +64,10 @@ public:
   void init()
   {
     getbits.bitbuf = 0;
-    getbits.vbits = getbits.reset = 0;
+    getbits.vbits = getbits.reset = getbits.ahead = 0;
+    getbits.stream = 0;
+    getbits.ptr = getbits.end = getbits.window;
+    getbits.wsize = getbits.filled = 0;
     ph1_bits.bitbuf = 0;
     ph1_bits.vbits = 0;
     pana_data.vpos = 0;
@@ -192,6 +202,9 @@ typedef struct
 
   unsigned dng_frames[LIBRAW_IFD_MAXCOUNT*2]; /* bits: 0-7: shot_select, 8-15: IFD#, 16-31: low 16 bit of newsubfile type */
   unsigned short raw_stride;
+  int rawband_done; /* raw rows already passed to rawband callback */
+  int rawband_ring; /* raw_image rows when it holds one band only, 0: full frame */
+  int roi_left, roi_top, roi_width, roi_height; /* unpack_roi() area, 0 width: full frame */
 } unpacker_data_t;
 
 typedef struct
@@ -233,6 +246,7 @@ struct jhead
 {
   int algo, bits, high, wide, clrs, sraw, psv, restart, vpred[6];
   ushort quant[64], idct[64], *huff[20], *free[20], *row;
+  int *fast[20];
 };
 
 struct libraw_tiff_tag
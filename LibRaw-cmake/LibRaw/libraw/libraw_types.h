@@ -123,6 +123,13 @@ typedef unsigned long long UINT64;
     unsigned decoder_flags;
   } libraw_decoder_info_t;
 
+  typedef struct
+  {
+    INT64 current_bytes; /* allocated by LibRaw object now */
+    INT64 peak_bytes;    /* max. since last recycle() */
+    INT64 allocations;   /* since object creation */
+  } libraw_memstats_t;
+
   typedef struct
   {
     unsigned mix_green;
@@ -145,6 +152,9 @@ typedef unsigned long long UINT64;
 
   typedef int (*progress_callback)(void *data, enum LibRaw_progress stage,
                                    int iteration, int expected);
+  /* band: first pixel of row, pitch: bytes per row; non-zero return cancels */
+  typedef int (*rawband_callback)(void *data, ushort *band, int pitch,
+                                  int row, int nrows);
   typedef int (*pre_identify_callback)(void *ctx);
   typedef void (*post_identify_callback)(void *ctx);
   typedef void (*process_step_callback)(void *ctx);
@@ -165,6 +175,9 @@ typedef unsigned long long UINT64;
         pre_preinterpolate_cb, pre_interpolate_cb, interpolate_bayer_cb,
         interpolate_xtrans_cb, post_interpolate_cb, pre_converttorgb_cb,
         post_converttorgb_cb;
+
+    rawband_callback rawband_cb;
+    void *rawbandcb_data;
   } libraw_callbacks_t;
 
   typedef struct
@@ -945,6 +958,11 @@ typedef unsigned long long UINT64;
       char p4shot_order[5];
       /* Custom camera list */
       char **custom_camera_strings;
+      /* rawband callback band height, 0: LIBRAW_RAWBAND_DEFAULT_ROWS */
+      unsigned rawband_rows;
+      /* recycle() keeps raw/image/thumbnail buffers up to this size for
+         next file, 0: free all */
+      unsigned keep_memory_mb;
   }libraw_raw_unpack_params_t;
 
   typedef struct
@@ -37,6 +37,7 @@ it under the terms of the one of two licenses as you choose:
 
 // this should be divisible by 4
 #define CRX_BUF_SIZE 0x10000
+#define CRX_BUF_MAXSIZE 0x40000
 #if !defined(_WIN32) || (defined(__GNUC__) && !defined(__INTRINSIC_SPECIAL__BitScanReverse))
 /* __INTRINSIC_SPECIAL__BitScanReverse found in MinGW32-W64 v7.30 headers, may be there is a better solution? */
 typedef uint32_t DWORD;
@@ -53,7 +54,8 @@ libraw_inline void _BitScanReverse(DWORD *Index, unsigned long Mask)
 
 struct CrxBitstream
 {
-  uint8_t mdatBuf[CRX_BUF_SIZE];
+  uint8_t *mdatBuf;
+  uint32_t mdatBufSize;
   uint64_t mdatSize;
   uint64_t curBufOffset;
   uint32_t curPos;
@@ -152,6 +154,63 @@ struct CrxTile
   uint16_t mdatExtraSize;
 };
 
+// Bump allocator kept by LibRaw object between files. All blocks are
+// released at once by clear(), it also grows the buffer to the largest
+// size needed so far: same geometry files do not allocate at all.
+struct CrxArena
+{
+  uint8_t *buf;
+  size_t size;
+  size_t used;
+  size_t peak;
+  std::vector<void *> overflow; // heap blocks used while buf is too small
+
+  CrxArena() : buf(0), size(0), used(0), peak(0) {}
+  ~CrxArena()
+  {
+    for (size_t i = 0; i < overflow.size(); i++)
+      ::free(overflow[i]);
+    ::free(buf);
+  }
+  void *alloc(size_t sz, bool zero = false)
+  {
+    void *ptr;
+    sz = (sz + 15) & ~size_t(15);
+    if (used + sz <= size)
+      ptr = buf + used;
+    else
+    {
+      if (!(ptr = ::malloc(sz)))
+        return 0;
+      overflow.push_back(ptr);
+    }
+    used += sz;
+    if (used > peak)
+      peak = used;
+    if (zero)
+      memset(ptr, 0, sz);
+    return ptr;
+  }
+  void clear()
+  {
+    for (size_t i = 0; i < overflow.size(); i++)
+      ::free(overflow[i]);
+    overflow.clear();
+    if (peak > size)
+    {
+      ::free(buf);
+      buf = (uint8_t *)::malloc(peak);
+      size = buf ? peak : 0;
+    }
+    used = 0;
+  }
+};
+
+// one arena per plane (subband data, used by plane decoding thread)
+// and one for image data
+#define CRX_ARENA_IMAGE 4
+#define CRX_ARENA_COUNT 5
+
 struct CrxImage
 {
   uint8_t nPlanes;
@@ -170,11 +229,10 @@ struct CrxImage
   uint64_t mdatSize;
   int16_t *outBufs[4]; // one per plane
   int16_t *planeBuf;
+  int32_t ringRows; // plane rows held in outBufs, 0: whole plane
+  int32_t roiLeft, roiTop, roiRight, roiBottom; // plane area to decode
   LibRaw_abstract_datastream *input;
-#ifdef LIBRAW_CR3_MEMPOOL
-  libraw_memmgr memmgr;
-  CrxImage() : memmgr(0) {}
-#endif
+  CrxArena *arena; // CRX_ARENA_COUNT items
 };
 
 enum TileFlags
@@ -200,28 +258,46 @@ uint32_t JS[32] = {1,    1,    1,     1,     2,     2,     2,      2,      4,
 uint32_t J[32] = {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,    2,    3,    3,    3,    3,
                   4, 4, 5, 5, 6, 6, 7, 7, 8, 9, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F};
 
+// buffer size for the bitstream: small streams are read at once,
+// large ones in chunks growing with stream size
+static inline uint32_t crxBitstreamBufSize(uint64_t mdatSize)
+{
+  if (mdatSize <= CRX_BUF_SIZE)
+    return (uint32_t)mdatSize;
+  return (uint32_t)_min(_min(mdatSize, CRX_BUF_MAXSIZE), _min(mdatSize / 16, CRX_BUF_MAXSIZE) + CRX_BUF_SIZE) & ~3U;
+}
+
 static inline void crxFillBuffer(CrxBitstream *bitStrm)
 {
   if (bitStrm->curPos >= bitStrm->curBufSize && bitStrm->mdatSize)
   {
     bitStrm->curPos = 0;
     bitStrm->curBufOffset += bitStrm->curBufSize;
+    uint32_t toRead = (uint32_t)_min(bitStrm->mdatSize, bitStrm->mdatBufSize);
+    if (bitStrm->input->read_at_parallel())
+      bitStrm->curBufSize = bitStrm->input->read_at(bitStrm->mdatBuf, toRead, bitStrm->curBufOffset);
+    else
+    {
 #ifdef LIBRAW_USE_OPENMP
 #pragma omp critical
 #endif
-    {
+      {
 #ifndef LIBRAW_USE_OPENMP
-      bitStrm->input->lock();
+        bitStrm->input->lock();
 #endif
-      bitStrm->input->seek(bitStrm->curBufOffset, SEEK_SET);
-      bitStrm->curBufSize = bitStrm->input->read(bitStrm->mdatBuf, 1, _min(bitStrm->mdatSize, CRX_BUF_SIZE));
+        bitStrm->curBufSize = bitStrm->input->read_at(bitStrm->mdatBuf, toRead, bitStrm->curBufOffset);
 #ifndef LIBRAW_USE_OPENMP
-      bitStrm->input->unlock();
+        bitStrm->input->unlock();
 #endif
+      }
     }
     if (bitStrm->curBufSize < 1) // nothing read
       throw LIBRAW_EXCEPTION_IO_EOF;
     bitStrm->mdatSize -= bitStrm->curBufSize;
+    // let the OS fetch next chunk while this one is decoded
+    if (bitStrm->mdatSize)
+      bitStrm->input->read_ahead(bitStrm->curBufOffset + bitStrm->curBufSize,
+                                 (size_t)_min(bitStrm->mdatSize, bitStrm->mdatBufSize));
   }
 }
 
@@ -1632,25 +1708,17 @@ int crxIdwt53FilterInitialize(CrxPlaneComp *comp, int32_t level, CrxQStep *qStep
   return 0;
 }
 
+// buffers are released by clearing the plane arena
 void crxFreeSubbandData(CrxImage *image, CrxPlaneComp *comp)
 {
-  if (comp->compBuf)
-  {
-    free(comp->compBuf);
-    comp->compBuf = 0;
-  }
+  comp->compBuf = 0;
 
   if (!comp->subBands)
     return;
 
   for (int32_t i = 0; i < image->subbandCount; i++)
   {
-    if (comp->subBands[i].bandParam)
-    {
-      free(comp->subBands[i].bandParam);
-      comp->subBands[i].bandParam = 0LL;
-    }
-
+    comp->subBands[i].bandParam = 0LL;
     comp->subBands[i].bandBuf = 0;
     comp->subBands[i].bandSize = 0;
   }
@@ -1659,9 +1727,11 @@ void crxFreeSubbandData(CrxImage *image, CrxPlaneComp *comp)
 void crxConvertPlaneLine(CrxImage *img, int imageRow, int imageCol = 0, int plane = 0, int32_t *lineData = 0,
                          int lineLength = 0)
 {
+  // outBufs may hold only the last ringRows rows (rawband ring mode)
+  int outRow = img->ringRows ? imageRow % img->ringRows : imageRow;
   if (lineData)
   {
-    uint64_t rawOffset = 4 * img->planeWidth * imageRow + 2 * imageCol;
+    uint64_t rawOffset = 4 * img->planeWidth * outRow + 2 * imageCol;
     if (img->encType == 1)
     {
       int32_t maxVal = 1 << (img->nBits - 1);
@@ -1688,12 +1758,12 @@ void crxConvertPlaneLine(CrxImage *img, int imageRow, int imageCol = 0, int plan
     {
       int32_t maxVal = (1 << img->nBits) - 1;
       int32_t median = 1 << (img->nBits - 1);
-      rawOffset = img->planeWidth * imageRow + imageCol;
+      rawOffset = img->planeWidth * outRow + imageCol;
       for (int i = 0; i < lineLength; i++)
         img->outBufs[0][rawOffset + i] = _constrain(median + lineData[i], 0, maxVal);
     }
   }
-  else if (img->encType == 3 && img->planeBuf)
+  else if (img->encType == 3 && img->planeBuf && imageRow >= img->roiTop && imageRow < img->roiBottom)
   {
     int32_t planeSize = img->planeWidth * img->planeHeight;
     int16_t *plane0 = img->planeBuf + imageRow * img->planeWidth;
@@ -1703,10 +1773,12 @@ void crxConvertPlaneLine(CrxImage *img, int imageRow, int imageCol = 0, int plan
 
     int32_t median = (1 << (img->medianBits - 1)) << 10;
     int32_t maxVal = (1 << img->medianBits) - 1;
-    uint32_t rawLineOffset = 4 * img->planeWidth * imageRow;
+    uint32_t rawLineOffset = 4 * img->planeWidth * outRow;
+    // columns outside unpack_roi() stay zero
+    int32_t roiRight = _min(img->roiRight, (int32_t)img->planeWidth);
 
     // for this stage - all except imageRow is ignored
-    for (int i = 0; i < img->planeWidth; i++)
+    for (int i = img->roiLeft; i < roiRight; i++)
     {
       int32_t gr = median + (plane0[i] << 10) - 168 * plane1[i] - 585 * plane3[i];
       int32_t val = 0;
@@ -1731,20 +1803,19 @@ void crxConvertPlaneLine(CrxImage *img, int imageRow, int imageCol = 0, int plan
   }
 }
 
-int crxParamInit(CrxImage *img, CrxBandParam **param, uint64_t subbandMdatOffset, uint64_t subbandDataSize,
+int crxParamInit(CrxImage *img, CrxArena *arena, CrxBandParam **param, uint64_t subbandMdatOffset, uint64_t subbandDataSize,
                  uint32_t subbandWidth, uint32_t subbandHeight, bool supportsPartial, uint32_t roundedBitsMask)
 {
   int32_t progrDataSize = supportsPartial ? 0 : sizeof(int32_t) * subbandWidth;
   int32_t paramLength = 2 * subbandWidth + 4;
-  uint8_t *paramBuf = 0;
-    paramBuf = (uint8_t *)
-#ifdef LIBRAW_CR3_MEMPOOL
-                   img->memmgr.
-#endif
-               calloc(1, sizeof(CrxBandParam) + sizeof(int32_t) * paramLength + progrDataSize);
+  int32_t paramSize = sizeof(CrxBandParam) + sizeof(int32_t) * paramLength + progrDataSize;
+  uint32_t mdatBufSize = crxBitstreamBufSize(subbandDataSize);
+  uint8_t *paramBuf = (uint8_t *)arena->alloc(paramSize + mdatBufSize);
 
   if (!paramBuf)
     return -1;
+  // the bitstream never reads past what crxFillBuffer() stored in mdatBuf
+  memset(paramBuf, 0, paramSize);
 
   *param = (CrxBandParam *)paramBuf;
 
@@ -1760,6 +1831,8 @@ int crxParamInit(CrxImage *img, CrxBandParam **param, uint64_t subbandMdatOffset
   (*param)->supportsPartial = supportsPartial;
   (*param)->bitStream.bitData = 0;
   (*param)->bitStream.bitsLeft = 0;
+  (*param)->bitStream.mdatBuf = paramBuf + sizeof(int32_t) * paramLength + progrDataSize;
+  (*param)->bitStream.mdatBufSize = mdatBufSize;
   (*param)->bitStream.mdatSize = subbandDataSize;
   (*param)->bitStream.curPos = 0;
   (*param)->bitStream.curBufSize = 0;
@@ -1803,11 +1876,7 @@ int crxSetupSubbandData(CrxImage *img, CrxPlaneComp *planeComp, const CrxTile *t
         compDataSize += 8 * sizeof(int32_t) * tile->width;
   }
     // buffer allocation
-    planeComp->compBuf = (uint8_t *)
-#ifdef LIBRAW_CR3_MEMPOOL
-                             img->memmgr.
-#endif
-                         malloc(compDataSize);
+  planeComp->compBuf = (uint8_t *)img->arena[planeComp->compNumber].alloc(compDataSize);
   if (!planeComp->compBuf)
     return -1;
 
@@ -1878,7 +1947,7 @@ int crxSetupSubbandData(CrxImage *img, CrxPlaneComp *planeComp, const CrxTile *t
         roundedBitsMask = planeComp->roundedBitsMask;
         supportsPartial = true;
       }
-      if (crxParamInit(img, &subbands[subbandNum].bandParam, subbands[subbandNum].mdatOffset,
+      if (crxParamInit(img, img->arena + planeComp->compNumber, &subbands[subbandNum].bandParam, subbands[subbandNum].mdatOffset,
                        subbands[subbandNum].dataSize, subbands[subbandNum].width, subbands[subbandNum].height,
                        supportsPartial, roundedBitsMask))
         return -1;
@@ -1888,61 +1957,108 @@ int crxSetupSubbandData(CrxImage *img, CrxPlaneComp *planeComp, const CrxTile *t
   return 0;
 }
 
-int LibRaw::crxDecodePlane(void *p, uint32_t planeNumber)
+// true if the tile overlaps decoded area
+static bool crxTileInRoi(const CrxImage *img, int tRow, int tCol)
 {
-  CrxImage *img = (CrxImage *)p;
-  int imageRow = 0;
-  for (int tRow = 0; tRow < img->tileRows; tRow++)
-  {
-    int imageCol = 0;
-    for (int tCol = 0; tCol < img->tileCols; tCol++)
-    {
-      CrxTile *tile = img->tiles + tRow * img->tileCols + tCol;
-      CrxPlaneComp *planeComp = tile->comps + planeNumber;
-      uint64_t tileMdatOffset = tile->dataOffset + tile->mdatQPDataSize + tile->mdatExtraSize + planeComp->dataOffset;
+  const CrxTile *tile = img->tiles + tRow * img->tileCols + tCol;
+  int32_t col = tCol * img->tiles[0].width;
+  int32_t row = tRow * img->tiles[0].height;
+  return col < img->roiRight && col + tile->width > img->roiLeft && row < img->roiBottom &&
+         row + tile->height > img->roiTop;
+}
 
-      // decode single tile
-      if (crxSetupSubbandData(img, planeComp, tile, tileMdatOffset))
-        return -1;
+// Decodes plane rows [rowStart, rowEnd), successive calls must continue
+// where the previous one stopped. Tiles of a tile row are set up on its
+// first line and released after its last one.
+static int crxDecodePlaneRows(CrxImage *img, uint32_t planeNumber, int32_t rowStart, int32_t rowEnd)
+{
+  int32_t tileHeight = img->tiles[0].height;
+  int32_t imageRow = rowStart;
+  while (imageRow < rowEnd)
+  {
+    int tRow = _min(imageRow / tileHeight, img->tileRows - 1);
+    CrxTile *rowTiles = img->tiles + tRow * img->tileCols;
+    int32_t tileRowStart = tRow * tileHeight;
+    int32_t tileRowEnd = tileRowStart + rowTiles->height;
 
-      if (img->levels)
+    if (imageRow == tileRowStart)
+      for (int tCol = 0; tCol < img->tileCols; tCol++)
       {
-        if (crxIdwt53FilterInitialize(planeComp, img->levels, tile->qStep))
+        if (!crxTileInRoi(img, tRow, tCol))
+          continue;
+        CrxTile *tile = rowTiles + tCol;
+        CrxPlaneComp *planeComp = tile->comps + planeNumber;
+        uint64_t tileMdatOffset = tile->dataOffset + tile->mdatQPDataSize + tile->mdatExtraSize + planeComp->dataOffset;
+
+        if (crxSetupSubbandData(img, planeComp, tile, tileMdatOffset))
           return -1;
-        for (int i = 0; i < tile->height; ++i)
+
+        if (img->levels)
         {
-          if (crxIdwt53FilterDecode(planeComp, img->levels - 1, tile->qStep) ||
-              crxIdwt53FilterTransform(planeComp, img->levels - 1))
+          if (crxIdwt53FilterInitialize(planeComp, img->levels, tile->qStep))
             return -1;
-          int32_t *lineData = crxIdwt53FilterGetLine(planeComp, img->levels - 1);
-          crxConvertPlaneLine(img, imageRow + i, imageCol, planeNumber, lineData, tile->width);
         }
+        else if (!planeComp->subBands->dataSize) // we have the only subband in this case
+          memset(planeComp->subBands->bandBuf, 0, planeComp->subBands->bandSize);
       }
-      else
+
+    for (int32_t rowLast = _min(rowEnd, tileRowEnd); imageRow < rowLast; ++imageRow)
+    {
+      int imageCol = 0;
+      for (int tCol = 0; tCol < img->tileCols; tCol++)
       {
-        // we have the only subband in this case
-        if (!planeComp->subBands->dataSize)
+        CrxTile *tile = rowTiles + tCol;
+        CrxPlaneComp *planeComp = tile->comps + planeNumber;
+        int32_t *lineData;
+        if (!crxTileInRoi(img, tRow, tCol))
         {
-          memset(planeComp->subBands->bandBuf, 0, planeComp->subBands->bandSize);
-          return 0;
+          imageCol += tile->width;
+          continue;
         }
-
-        for (int i = 0; i < tile->height; ++i)
+        if (img->levels)
         {
-          if (crxDecodeLine(planeComp->subBands->bandParam, planeComp->subBands->bandBuf))
+          if (crxIdwt53FilterDecode(planeComp, img->levels - 1, tile->qStep) ||
+              crxIdwt53FilterTransform(planeComp, img->levels - 1))
             return -1;
-          int32_t *lineData = (int32_t *)planeComp->subBands->bandBuf;
-          crxConvertPlaneLine(img, imageRow + i, imageCol, planeNumber, lineData, tile->width);
+          lineData = crxIdwt53FilterGetLine(planeComp, img->levels - 1);
         }
+        else
+        {
+          if (planeComp->subBands->dataSize &&
+              crxDecodeLine(planeComp->subBands->bandParam, planeComp->subBands->bandBuf))
+            return -1;
+          lineData = (int32_t *)planeComp->subBands->bandBuf;
+        }
+        crxConvertPlaneLine(img, imageRow, imageCol, planeNumber, lineData, tile->width);
+        imageCol += tile->width;
       }
-      imageCol += tile->width;
     }
-    imageRow += img->tiles[tRow * img->tileCols].height;
+
+    if (imageRow == tileRowEnd)
+    {
+      for (int tCol = 0; tCol < img->tileCols; tCol++)
+        crxFreeSubbandData(img, rowTiles[tCol].comps + planeNumber);
+      img->arena[planeNumber].clear();
+    }
   }
 
   return 0;
 }
 
+// Releases what a plane holds after crxDecodePlaneRows() failed in it
+static void crxReleasePlane(CrxImage *img, uint32_t planeNumber)
+{
+  for (int i = 0; i < img->tileRows * img->tileCols; i++)
+    crxFreeSubbandData(img, img->tiles[i].comps + planeNumber);
+  img->arena[planeNumber].clear();
+}
+
+int LibRaw::crxDecodePlane(void *p, uint32_t planeNumber)
+{
+  CrxImage *img = (CrxImage *)p;
+  return crxDecodePlaneRows(img, planeNumber, 0, img->planeHeight);
+}
+
 uint32_t crxReadQP(CrxBitstream *bitStrm, int32_t kParam)
 {
   uint32_t qp = crxBitstreamGetZeros(bitStrm);
@@ -2003,11 +2119,8 @@ int crxMakeQStep(CrxImage *img, CrxTile *tile, int32_t *qpTable, uint32_t /*tota
     totalHeight += qpHeight4;
   if (img->levels > 2)
     totalHeight += qpHeight8;
-    tile->qStep = (CrxQStep *)
-#ifdef LIBRAW_CR3_MEMPOOL
-                      img->memmgr.
-#endif
-                  malloc(totalHeight * qpWidth * sizeof(uint32_t) + img->levels * sizeof(CrxQStep));
+  tile->qStep = (CrxQStep *)img->arena[CRX_ARENA_IMAGE].alloc(totalHeight * qpWidth * sizeof(uint32_t) +
+                                                               img->levels * sizeof(CrxQStep));
 
   if (!tile->qStep)
     return -1;
@@ -2259,13 +2372,10 @@ int crxReadImageHeaders(crx_data_header_t *hdr, CrxImage *img, uint8_t *mdatPtr,
 
   if (!img->tiles)
   {
-      img->tiles = (CrxTile *)
-#ifdef LIBRAW_CR3_MEMPOOL
-                       img->memmgr.
-#endif
-                   calloc(sizeof(CrxTile) * nTiles + sizeof(CrxPlaneComp) * nTiles * img->nPlanes +
-                              sizeof(CrxSubband) * nTiles * img->nPlanes * img->subbandCount,
-                          1);
+    img->tiles = (CrxTile *)img->arena[CRX_ARENA_IMAGE].alloc(
+        sizeof(CrxTile) * nTiles + sizeof(CrxPlaneComp) * nTiles * img->nPlanes +
+            sizeof(CrxSubband) * nTiles * img->nPlanes * img->subbandCount,
+        true);
     if (!img->tiles)
       return -1;
 
@@ -2441,13 +2551,16 @@ int crxReadImageHeaders(crx_data_header_t *hdr, CrxImage *img, uint8_t *mdatPtr,
   tile = img->tiles;
   for (int curTile = 0; curTile < nTiles; ++curTile, ++tile)
   {
-    if (tile->hasQPData)
+    if (tile->hasQPData && crxTileInRoi(img, curTile / img->tileCols, curTile % img->tileCols))
     {
       CrxBitstream bitStrm;
+      std::vector<uint8_t> qpBuf(crxBitstreamBufSize(tile->mdatQPDataSize));
       bitStrm.bitData = 0;
       bitStrm.bitsLeft = 0;
       bitStrm.curPos = 0;
       bitStrm.curBufSize = 0;
+      bitStrm.mdatBuf = qpBuf.data();
+      bitStrm.mdatBufSize = (uint32_t)qpBuf.size();
       bitStrm.mdatSize = tile->mdatQPDataSize;
       bitStrm.curBufOffset = img->mdatOffset + tile->dataOffset;
       bitStrm.input = img->input;
@@ -2521,6 +2634,7 @@ int crxSetupImageData(crx_data_header_t *hdr, CrxImage *img, int16_t *outBuf, ui
   img->mdatOffset = mdatOffset + hdr->mdatHdrSize;
   img->mdatSize = mdatSize;
   img->planeBuf = 0;
+  img->ringRows = 0;
   img->outBufs[0] = img->outBufs[1] = img->outBufs[2] = img->outBufs[3] = 0;
   img->medianBits = hdr->medianBits;
 
@@ -2532,11 +2646,8 @@ int crxSetupImageData(crx_data_header_t *hdr, CrxImage *img, int16_t *outBuf, ui
   // left as is.
   if (img->encType == 3 && img->nPlanes == 4 && img->nBits > 8)
   {
-      img->planeBuf = (int16_t *)
-#ifdef LIBRAW_CR3_MEMPOOL
-                          img->memmgr.
-#endif
-                      malloc(img->planeHeight * img->planeWidth * img->nPlanes * ((img->samplePrecision + 7) >> 3));
+    img->planeBuf = (int16_t *)img->arena[CRX_ARENA_IMAGE].alloc(img->planeHeight * img->planeWidth * img->nPlanes *
+                                                                 ((img->samplePrecision + 7) >> 3));
     if (!img->planeBuf)
       return -1;
   }
@@ -2588,34 +2699,19 @@ int crxSetupImageData(crx_data_header_t *hdr, CrxImage *img, int16_t *outBuf, ui
 
 int crxFreeImageData(CrxImage *img)
 {
-#ifdef LIBRAW_CR3_MEMPOOL
-  img->memmgr.cleanup();
-#else
-  CrxTile *tile = img->tiles;
-  int nTiles = img->tileRows * img->tileCols;
-
-  if (img->tiles)
-  {
-    for (int32_t curTile = 0; curTile < nTiles; curTile++)
-    {
-      if (tile[curTile].comps)
-        for (int32_t curPlane = 0; curPlane < img->nPlanes; curPlane++)
-          crxFreeSubbandData(img, tile[curTile].comps + curPlane);
-      if (tile[curTile].qStep)
-        free(tile[curTile].qStep);
-    }
-    free(img->tiles);
-    img->tiles = 0;
-  }
-
-  if (img->planeBuf)
-  {
-    free(img->planeBuf);
-    img->planeBuf = 0;
-  }
-#endif
+  for (int i = 0; i < CRX_ARENA_COUNT; i++)
+    img->arena[i].clear();
+  img->tiles = 0;
+  img->planeBuf = 0;
   return 0;
 }
+
+void LibRaw::crxFreeArena()
+{
+  delete[](CrxArena *) _crx_arena;
+  _crx_arena = 0;
+}
+
 void LibRaw::crxLoadDecodeLoop(void *img, int nPlanes)
 {
 #ifdef LIBRAW_USE_OPENMP
@@ -2638,6 +2734,63 @@ void LibRaw::crxLoadDecodeLoop(void *img, int nPlanes)
 #endif
 }
 
+void LibRaw::crxLoadDecodeBands(void *p, int nPlanes)
+{
+  CrxImage *img = (CrxImage *)p;
+  int rowScale = nPlanes == 4 ? 2 : 1; // raw rows per plane row
+  int bandRows = rawband_height() / rowScale;
+  // a plane that failed stops there, as in crxLoadDecodeLoop(): its subband
+  // state is not fit to continue from
+  int failed[4] = {0, 0, 0, 0}; // nPlanes is always <= 4
+  for (int rowStart = 0; rowStart < img->planeHeight; rowStart += bandRows)
+  {
+    int rowEnd = _min(rowStart + bandRows, img->planeHeight);
+    checkCancel();
+    if (img->ringRows && libraw_internal_data.unpacker_data.roi_width)
+      memset(imgdata.rawdata.raw_image, 0, size_t(bandRows) * rowScale * S.raw_pitch);
+    int results[4] = {0, 0, 0, 0};
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for
+    for (int32_t plane = 0; plane < nPlanes; ++plane)
+      try
+      {
+        if (!failed[plane])
+          results[plane] = crxDecodePlaneRows(img, plane, rowStart, rowEnd);
+      }
+      catch (...)
+      {
+        results[plane] = 1;
+      }
+#else
+    for (int32_t plane = 0; plane < nPlanes; ++plane)
+      if (!failed[plane])
+        results[plane] = crxDecodePlaneRows(img, plane, rowStart, rowEnd);
+#endif
+
+    for (int32_t plane = 0; plane < nPlanes; ++plane)
+      if (results[plane])
+      {
+        failed[plane] = 1;
+        crxReleasePlane(img, plane);
+        derror();
+      }
+    if (img->encType == 3)
+    {
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int i = rowStart; i < rowEnd; ++i)
+        crxConvertPlaneLineDf(img, i);
+    }
+
+    int row = rowStart * rowScale;
+    int nrows = _min(rowEnd * rowScale, (int)S.raw_height) - row;
+    if (nrows > 0)
+      rawband_send(imgdata.rawdata.raw_image + (img->ringRows ? 0 : size_t(row) * S.raw_pitch / 2), row, nrows);
+    libraw_internal_data.unpacker_data.rawband_done = row + MAX(nrows, 0);
+  }
+}
+
 void LibRaw::crxConvertPlaneLineDf(void *p, int imageRow) { crxConvertPlaneLine((CrxImage *)p, imageRow); }
 
 void LibRaw::crxLoadFinalizeLoopE3(void *p, int planeHeight)
@@ -2663,6 +2816,10 @@ void LibRaw::crxLoadRaw()
     derror();
 
   img.input = libraw_internal_data.internal_data.input;
+  if (!_crx_arena)
+    _crx_arena = new CrxArena[CRX_ARENA_COUNT];
+  img.arena = (CrxArena *)_crx_arena;
+  crxFreeImageData(&img); // previous decode may have failed
 
   // update sizes for the planes
   if (hdr.nPlanes == 4)
@@ -2696,16 +2853,49 @@ void LibRaw::crxLoadRaw()
   if (bytes != hdr.mdatHdrSize)
     throw LIBRAW_EXCEPTION_IO_EOF;
 
+  // unpack_roi(): only tiles covering the area are decoded
+  int rowScale = hdr.nPlanes == 4 ? 2 : 1;
+  img.roiLeft = img.roiTop = 0;
+  img.roiRight = hdr.f_width;
+  img.roiBottom = hdr.f_height;
+  if (libraw_internal_data.unpacker_data.roi_width)
+  {
+    int left = libraw_internal_data.unpacker_data.roi_left + S.left_margin;
+    int top = libraw_internal_data.unpacker_data.roi_top + S.top_margin;
+    img.roiLeft = left / rowScale;
+    img.roiTop = top / rowScale;
+    img.roiRight = (left + libraw_internal_data.unpacker_data.roi_width + rowScale - 1) / rowScale;
+    img.roiBottom = (top + libraw_internal_data.unpacker_data.roi_height + rowScale - 1) / rowScale;
+    // ring rows are reused, but columns outside the area are never written
+    memset(imgdata.rawdata.raw_image, 0,
+           size_t(S.raw_pitch) * (libraw_internal_data.unpacker_data.rawband_ring
+                                      ? libraw_internal_data.unpacker_data.rawband_ring
+                                      : S.raw_height));
+  }
+
   // parse and setup the image data
   if (crxSetupImageData(&hdr, &img, (int16_t *)imgdata.rawdata.raw_image,
 	  libraw_internal_data.unpacker_data.data_offset, libraw_internal_data.unpacker_data.data_size,
 	  hdrBuf.data(), hdr.mdatHdrSize))
     throw LIBRAW_EXCEPTION_IO_CORRUPT;
 
-  crxLoadDecodeLoop(&img, hdr.nPlanes);
+  if (img.planeBuf && libraw_internal_data.unpacker_data.roi_width)
+    memset(img.planeBuf, 0,
+           img.planeHeight * img.planeWidth * img.nPlanes * ((img.samplePrecision + 7) >> 3));
 
-  if (img.encType == 3)
-    crxLoadFinalizeLoopE3(&img, img.planeHeight);
+  if (callbacks.rawband_cb)
+  {
+    // ring mode: raw_image holds a single band
+    img.ringRows = libraw_internal_data.unpacker_data.rawband_ring / rowScale;
+    crxLoadDecodeBands(&img, hdr.nPlanes);
+  }
+  else
+  {
+    crxLoadDecodeLoop(&img, hdr.nPlanes);
+
+    if (img.encType == 3)
+      crxLoadFinalizeLoopE3(&img, img.planeHeight);
+  }
 
   crxFreeImageData(&img);
 }
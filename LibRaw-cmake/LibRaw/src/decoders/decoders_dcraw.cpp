@@ -19,31 +19,95 @@
 #include "../../internal/dcraw_defs.h"
 #include "../../internal/libraw_cameraids.h"
 
+/* Bytes for getbithuff() come from a read-ahead window instead of one
+   get_char() call each. The stream is left at the end of the window;
+   getbits_settle() moves it back to the last byte actually used, so code
+   doing its own I/O between bit reads sees the same position as before. */
+int LibRaw::getbits_fill()
+{
+  int wsize = tls->getbits.stream ? MIN(tls->getbits.wsize * 2, LIBRAW_GETBITS_MAXWINDOW)
+                                  : LIBRAW_GETBITS_MINWINDOW;
+  int n = ifp->read(tls->getbits.window, 1, wsize);
+  if (n < 0)
+    n = 0;
+  tls->getbits.stream = ifp;
+  tls->getbits.fill_end = ifp->tell();
+  tls->getbits.wsize = wsize;
+  tls->getbits.filled = n;
+  tls->getbits.ptr = tls->getbits.window;
+  tls->getbits.end = tls->getbits.window + n;
+  return n ? *tls->getbits.ptr++ : EOF;
+}
+
+void LibRaw::getbits_settle()
+{
+  LibRaw_abstract_datastream *stream = tls->getbits.stream;
+  INT64 unread = tls->getbits.end - tls->getbits.ptr + tls->getbits.ahead;
+  int wasshort = tls->getbits.filled && tls->getbits.filled < tls->getbits.wsize;
+  tls->getbits.bitbuf >>= 8 * tls->getbits.ahead;
+  tls->getbits.ahead = 0;
+  tls->getbits.stream = 0;
+  tls->getbits.ptr = tls->getbits.end = tls->getbits.window;
+  /* a short read leaves the stream at EOF, which get_char() would not */
+  if (stream == ifp && (unread || wasshort) &&
+      stream->tell() == tls->getbits.fill_end)
+    stream->seek(tls->getbits.fill_end - unread, SEEK_SET);
+}
+
+/* vbits counts bits the way a byte-at-a-time reader would have them: bytes
+   are only taken when a request needs them. Below those, bitbuf may hold
+   "ahead" more whole bytes fetched early, still unread as far as the
+   stream position is concerned. */
 unsigned LibRaw::getbithuff(int nbits, ushort *huff)
 {
-#ifdef LIBRAW_NOTHREADS
-  static unsigned bitbuf = 0;
-  static int vbits = 0, reset = 0;
-#else
-#define bitbuf tls->getbits.bitbuf
-#define vbits tls->getbits.vbits
-#define reset tls->getbits.reset
-#endif
+#define getbits_byte()                                                         \
+  (tls->getbits.ptr < tls->getbits.end ? *tls->getbits.ptr++                   \
+                                       : (unsigned)getbits_fill())
   unsigned c;
 
   if (nbits > 25)
     return 0;
   if (nbits < 0)
-    return bitbuf = vbits = reset = 0;
+    return tls->getbits.vbits = tls->getbits.reset = 0;
+  int vbits = tls->getbits.vbits;
   if (nbits == 0 || vbits < 0)
     return 0;
-  while (!reset && vbits < nbits && (c = fgetc(ifp)) != (unsigned)EOF &&
-         !(reset = zero_after_ff && c == 0xff && fgetc(ifp)))
+  UINT64 bitbuf = tls->getbits.bitbuf;
+  int ahead = tls->getbits.ahead;
+  if (!tls->getbits.reset && vbits < nbits)
   {
-    bitbuf = (bitbuf << 8) + (uchar)c;
-    vbits += 8;
+    int need = (nbits - vbits + 7) >> 3;
+    int zaf = zero_after_ff;
+    if (ahead < need)
+    {
+      const uchar *p = tls->getbits.ptr, *e = tls->getbits.end;
+      while (vbits + 8 * ahead <= 56 && p < e && !(zaf && *p == 0xff))
+      {
+        bitbuf = (bitbuf << 8) + *p++;
+        ahead++;
+      }
+      tls->getbits.ptr = p;
+    }
+    if (ahead >= need)
+    {
+      ahead -= need;
+      vbits += need * 8;
+    }
+    else
+    {
+      int reset = 0;
+      vbits += ahead * 8;
+      ahead = 0;
+      while (vbits < nbits && (c = getbits_byte()) != (unsigned)EOF &&
+             !(reset = zaf && c == 0xff && getbits_byte()))
+      {
+        bitbuf = (bitbuf << 8) + (uchar)c;
+        vbits += 8;
+      }
+      tls->getbits.reset = reset;
+    }
   }
-  c = vbits == 0 ? 0 : bitbuf << (32 - vbits) >> (32 - nbits);
+  c = vbits == 0 ? 0 : unsigned(bitbuf << (64 - vbits - 8 * ahead) >> (64 - nbits));
   if (huff)
   {
     vbits -= huff[c] >> 8;
@@ -51,14 +115,13 @@ unsigned LibRaw::getbithuff(int nbits, ushort *huff)
   }
   else
     vbits -= nbits;
+  tls->getbits.bitbuf = bitbuf;
+  tls->getbits.vbits = vbits;
+  tls->getbits.ahead = ahead;
   if (vbits < 0)
     derror();
   return c;
-#ifndef LIBRAW_NOTHREADS
-#undef bitbuf
-#undef vbits
-#undef reset
-#endif
+#undef getbits_byte
 }
 
 /*
@@ -96,13 +159,17 @@ ushort *LibRaw::make_decoder_ref(const uchar **source)
   count = (*source += 16) - 17;
   for (max = 16; max && !count[max]; max--)
     ;
-  huff = (ushort *)calloc(1 + (1 << max), sizeof *huff);
+  huff = (ushort *)calloc(
+      ((2 + (1 << max)) & ~1) * sizeof *huff +
+          (1 + (1 << MIN(max, LIBRAW_HUFF_LOOKAHEAD))) * sizeof(int),
+      1);
   huff[0] = max;
   for (h = len = 1; len <= max; len++)
     for (i = 0; i < count[len]; i++, ++*source)
       for (j = 0; j < 1 << (max - len); j++)
         if (h <= 1 << max)
           huff[h++] = len << 8 | **source;
+  make_lookahead(huff, decoder_lookahead(huff), 0);
   return huff;
 }
 
@@ -111,6 +178,51 @@ ushort *LibRaw::make_decoder(const uchar *source)
   return make_decoder_ref(&source);
 }
 
+/*
+   Index the first MIN(max, LIBRAW_HUFF_LOOKAHEAD) bits of a decoder and
+   resolve each code together with the difference bits that follow it:
+   fast[0] is the shift from max bits to the index, fast[1 + index] is
+   diff * 64 + bits used, or 63 when the code and its difference don't
+   fit in the index (those go through gethuff() and getbits()).
+   Differences are decoded as in ljpeg_diff(), or as in nikon_load_raw()
+   when nikon is set.
+ */
+void LibRaw::make_lookahead(const ushort *huff, int *fast, int nikon)
+{
+  int max = huff[0], bits = MIN(max, LIBRAW_HUFF_LOOKAHEAD);
+  int i, j, len, sym, nb, x, diff, e, shl;
+  const ushort *h;
+
+  fast[0] = max - bits;
+  for (i = 0; i < 1 << bits; i++)
+  {
+    h = huff + 1 + (i << fast[0]);
+    for (j = 1; j < 1 << fast[0] && h[j] == h[0]; j++)
+      ;
+    len = h[0] >> 8;
+    sym = (uchar)h[0];
+    shl = nikon ? sym >> 4 : 0;
+    nb = nikon ? (sym & 15) - shl : sym;
+    e = 63;
+    if (j == 1 << fast[0] && nb >= 0 && len + nb <= bits)
+    {
+      x = (i >> (bits - len - nb)) & ((1 << nb) - 1);
+      if (nikon)
+      {
+        diff = ((x << 1) + 1) << shl >> 1;
+        if ((sym & 15) > 0 && (diff & (1 << ((sym & 15) - 1))) == 0)
+          diff -= (1 << (sym & 15)) - !shl;
+      }
+      else if (nb && (x & (1 << (nb - 1))) == 0)
+        diff = x - ((1 << nb) - 1);
+      else
+        diff = x;
+      e = diff * 64 + len + nb;
+    }
+    fast[1 + i] = e;
+  }
+}
+
 void LibRaw::crw_init_tables(unsigned table, ushort *huff[2])
 {
   static const uchar first_tree[3][29] = {
@@ -347,6 +459,7 @@ int LibRaw::ljpeg_start(struct jhead *jh, int info_only)
     FORC(4) jh->huff[2 + c] = jh->huff[1];
     FORC(jh->sraw) jh->huff[1 + c] = jh->huff[0];
   }
+  FORC(20) jh->fast[c] = decoder_lookahead(jh->huff[c]);
   jh->row = (ushort *)calloc(jh->wide * jh->clrs, 16);
   return zero_after_ff = 1;
 }
@@ -400,7 +513,7 @@ ushort *LibRaw::ljpeg_row(int jrow, struct jhead *jh)
   for (col = 0; col < jh->wide; col++)
     FORC(jh->clrs)
     {
-      diff = ljpeg_diff(jh->huff[c]);
+      diff = ljpeg_diff_fast(jh->huff[c], jh->fast[c]);
       if (jh->sraw && c <= jh->sraw && (col | c))
         pred = spred;
       else if (col)
@@ -466,7 +579,7 @@ ushort *LibRaw::ljpeg_row_unrolled(int jrow, struct jhead *jh)
   // The first column uses one particular predictor.
   FORC(jh->clrs)
   {
-    diff = ljpeg_diff(jh->huff[c]);
+    diff = ljpeg_diff_fast(jh->huff[c], jh->fast[c]);
     pred = (jh->vpred[c] += diff) - diff;
     if ((**row = pred + diff) >> jh->bits)
       derror();
@@ -479,7 +592,7 @@ ushort *LibRaw::ljpeg_row_unrolled(int jrow, struct jhead *jh)
     for (col = 1; col < jh->wide; col++)
       FORC(jh->clrs)
       {
-        diff = ljpeg_diff(jh->huff[c]);
+        diff = ljpeg_diff_fast(jh->huff[c], jh->fast[c]);
         pred = row[0][-jh->clrs];
         if ((**row = pred + diff) >> jh->bits)
           derror();
@@ -492,7 +605,7 @@ ushort *LibRaw::ljpeg_row_unrolled(int jrow, struct jhead *jh)
     for (col = 1; col < jh->wide; col++)
       FORC(jh->clrs)
       {
-        diff = ljpeg_diff(jh->huff[c]);
+        diff = ljpeg_diff_fast(jh->huff[c], jh->fast[c]);
         pred = row[0][-jh->clrs];
         if ((**row = pred + diff) >> jh->bits)
           derror();
@@ -504,7 +617,7 @@ ushort *LibRaw::ljpeg_row_unrolled(int jrow, struct jhead *jh)
     for (col = 1; col < jh->wide; col++)
       FORC(jh->clrs)
       {
-        diff = ljpeg_diff(jh->huff[c]);
+        diff = ljpeg_diff_fast(jh->huff[c], jh->fast[c]);
         pred = row[0][-jh->clrs];
         switch (jh->psv)
         {
@@ -540,9 +653,101 @@ ushort *LibRaw::ljpeg_row_unrolled(int jrow, struct jhead *jh)
   return row[2];
 }
 
+/*
+   Check that no pixel of jrow would make lossless_jpeg_load_raw() throw:
+   output rows only grow along a jrow, so its last pixel decides.
+ */
+int LibRaw::lossless_jpeg_row_fits(int jrow, int jwide)
+{
+  int jidx, i, j, row, col;
+
+  if (!cr2_slice[0])
+  {
+    if (load_flags & 1)
+      return 1;
+    return (jrow + 1) * (jwide / raw_width) - 1 <= raw_height;
+  }
+  jidx = jrow * jwide + jwide - 1;
+  i = jidx / (cr2_slice[1] * raw_height);
+  if ((j = i >= cr2_slice[0]))
+    i = cr2_slice[0];
+  if (!cr2_slice[1 + j])
+    return 0;
+  jidx -= i * (cr2_slice[1] * raw_height);
+  row = jidx / cr2_slice[1 + j];
+  col = jidx % cr2_slice[1 + j] + i * cr2_slice[1];
+  if (raw_width == 3984 && col < 2)
+    row--;
+  return row <= raw_height;
+}
+
+/*
+   Store nrows decoded jrows (from jrow0 on) into raw_image.  Each jrow
+   starts from one division, then walks the slice rows it covers.
+ */
+void LibRaw::lossless_jpeg_remap(const ushort *src, int jrow0, int nrows,
+                                 int jwide)
+{
+  int n;
+
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared)
+#endif
+  for (n = 0; n < nrows; n++)
+  {
+    const ushort *sp = src + size_t(n) * jwide;
+    int jrow = jrow0 + n, jcol, i, j, w, run, k, row, col;
+    ushort *dp;
+
+    if (!cr2_slice[0])
+    {
+      row = load_flags & 1 ? (jrow & 1 ? height - 1 - jrow / 2 : jrow / 2)
+                           : jrow * (jwide / raw_width);
+      for (jcol = 0; jcol < jwide; jcol += raw_width, row++)
+        if ((unsigned)row < raw_height)
+          for (dp = &RAW(row, 0), k = 0; k < raw_width; k++)
+            dp[k] = curve[sp[jcol + k]];
+      continue;
+    }
+    jcol = jrow * jwide;
+    i = jcol / (cr2_slice[1] * raw_height);
+    if ((j = i >= cr2_slice[0]))
+      i = cr2_slice[0];
+    w = cr2_slice[1 + j];
+    jcol -= i * (cr2_slice[1] * raw_height);
+    row = jcol / w;
+    col = jcol % w;
+    for (jcol = 0; jcol < jwide; jcol += run)
+    {
+      run = MIN(w - col, jwide - jcol);
+      col += i * cr2_slice[1];
+      if (raw_width == 3984)
+      {
+        for (k = 0; k < run; k++)
+          if (col + k >= 2 && (unsigned)row < raw_height)
+            RAW(row, col + k - 2) = curve[sp[jcol + k]];
+          else if (col + k < 2 && (unsigned)(row - 1) < raw_height)
+            RAW(row - 1, col + k - 2 + raw_width) = curve[sp[jcol + k]];
+      }
+      else if ((unsigned)row < raw_height)
+        for (dp = &RAW(row, col), k = 0; k < run; k++)
+          dp[k] = curve[sp[jcol + k]];
+      col = 0;
+      if (++row == raw_height && !j)
+      {
+        row = 0;
+        if ((j = ++i >= cr2_slice[0]))
+          i = cr2_slice[0];
+        w = cr2_slice[1 + j];
+      }
+    }
+  }
+}
+
 void LibRaw::lossless_jpeg_load_raw()
 {
   int jwide, jhigh, jrow, jcol, val, jidx, i, j, row = 0, col = 0;
+  int fast, band = 0;
   struct jhead jh;
   ushort *rp;
 
@@ -560,12 +765,42 @@ void LibRaw::lossless_jpeg_load_raw()
   if (jh.clrs == 4 && jwide >= raw_width * 2)
     jhigh *= 2;
 
+  // Entropy decoding is serial; when every jrow has a known place in
+  // raw_image, decoded jrows are collected and stored in parallel.
+  if (cr2_slice[0])
+    fast = cr2_slice[0] * cr2_slice[1] + cr2_slice[2] <= raw_width;
+  else
+    fast = raw_width > 0 && raw_width != 3984 && jwide % raw_width == 0 &&
+           (!(load_flags & 1) || (jwide == raw_width && jh.high <= height));
+  std::vector<ushort> decoded(fast ? size_t(LIBRAW_LJPEG_BAND) * jwide : 0);
+
   try
   {
     for (jrow = 0; jrow < jh.high; jrow++)
     {
       checkCancel();
       rp = ljpeg_row(jrow, &jh);
+      if (fast && lossless_jpeg_row_fits(jrow, jwide))
+      {
+        memcpy(&decoded[size_t(band++) * jwide], rp, jwide * sizeof *rp);
+        if (band < LIBRAW_LJPEG_BAND && jrow + 1 < jh.high)
+          continue;
+        lossless_jpeg_remap(&decoded[0], jrow + 1 - band, band, jwide);
+        band = 0;
+        if (!cr2_slice[0] && !(load_flags & 1))
+          rawband_flush((jrow + 1) * (jwide / raw_width), 0);
+        continue;
+      }
+      if (band)
+      {
+        lossless_jpeg_remap(&decoded[0], jrow - band, band, jwide);
+        band = 0;
+      }
+      if (fast && !cr2_slice[0]) // the jrow below throws
+      {
+        row = jrow * (jwide / raw_width);
+        col = 0;
+      }
       if (load_flags & 1)
         row = jrow & 1 ? height - 1 - jrow / 2 : jrow / 2;
       for (jcol = 0; jcol < jwide; jcol++)
@@ -593,6 +828,8 @@ void LibRaw::lossless_jpeg_load_raw()
         if (++col >= raw_width)
           col = (row++, 0);
       }
+      if (!cr2_slice[0] && !(load_flags & 1)) // rows above are complete
+        rawband_flush(row - (raw_width == 3984), 0);
     }
   }
   catch (...)
@@ -804,8 +1041,9 @@ void LibRaw::ljpeg_idct(struct jhead *jh)
 
 void LibRaw::pentax_load_raw()
 {
-  ushort bit[2][15], huff[4097];
+  ushort bit[2][15], huff[4097] = {0};
   int dep, row, col, diff, c, i;
+  std::vector<int> fast(1 + (1 << LIBRAW_HUFF_LOOKAHEAD));
   ushort vpred[2][2] = {{0, 0}, {0, 0}}, hpred[2];
 
   fseek(ifp, meta_offset, SEEK_SET);
@@ -817,6 +1055,7 @@ void LibRaw::pentax_load_raw()
   for (i = bit[0][c]; i <= ((bit[0][c] + (4096 >> bit[1][c]) - 1) & 4095);)
     huff[++i] = bit[1][c] << 8 | c;
   huff[0] = 12;
+  make_lookahead(huff, &fast[0], 0);
   fseek(ifp, data_offset, SEEK_SET);
   getbits(-1);
   for (row = 0; row < raw_height; row++)
@@ -824,7 +1063,7 @@ void LibRaw::pentax_load_raw()
     checkCancel();
     for (col = 0; col < raw_width; col++)
     {
-      diff = ljpeg_diff(huff);
+      diff = ljpeg_diff_fast(huff, &fast[0]);
       if (col < 2)
         hpred[col] = vpred[row & 1][col] += diff;
       else
@@ -887,6 +1126,7 @@ void LibRaw::nikon_load_raw()
        7, 6, 8, 5, 9, 4, 10, 3, 11, 12, 2, 0, 1, 13, 14}};
   ushort *huff, ver0, ver1, vpred[2][2], hpred[2];
   int i, min, max, tree = 0, split = 0, row, col, len, shl, diff;
+  std::vector<int> fast(1 + (1 << LIBRAW_HUFF_LOOKAHEAD));
 
   fseek(ifp, meta_offset, SEEK_SET);
   ver0 = fgetc(ifp);
@@ -910,45 +1150,77 @@ void LibRaw::nikon_load_raw()
   while (max > 2 && (curve[max - 2] == curve[max - 1]))
     max--;
   huff = make_decoder(nikon_tree[tree]);
+  make_lookahead(huff, &fast[0], 1);
   fseek(ifp, data_offset, SEEK_SET);
   getbits(-1);
+  /*
+     Two passes per band of rows: the Huffman stream and the predictors are
+     serial (the range check feeds derror(), which looks at the stream
+     position), so predicted values are stored first and mapped through
+     curve[] in parallel once the band is complete.
+   */
+  ushort *band = raw_image;
   try
   {
     for (min = row = 0; row < height; row++)
     {
+      if (row && !(row % LIBRAW_RAW_BAND))
+      {
+        nikon_apply_curve(band, &RAW(row, 0));
+        band = &RAW(row, 0);
+      }
+      col = 0;
       checkCancel();
       if (split && row == split)
       {
         free(huff);
         huff = make_decoder(nikon_tree[tree + 1]);
+        make_lookahead(huff, &fast[0], 1);
         max += (min = 16) << 1;
       }
       for (col = 0; col < raw_width; col++)
       {
-        i = gethuff(huff);
-        len = i & 15;
-        shl = i >> 4;
-        diff = ((getbits(len - shl) << 1) + 1) << shl >> 1;
-        if (len > 0 && (diff & (1 << (len - 1))) == 0)
-          diff -= (1 << len) - !shl;
+        if (!lookahead_diff(huff, &fast[0], &diff))
+        {
+          i = gethuff(huff);
+          len = i & 15;
+          shl = i >> 4;
+          diff = ((getbits(len - shl) << 1) + 1) << shl >> 1;
+          if (len > 0 && (diff & (1 << (len - 1))) == 0)
+            diff -= (1 << len) - !shl;
+        }
         if (col < 2)
           hpred[col] = vpred[row & 1][col] += diff;
         else
           hpred[col & 1] += diff;
         if ((ushort)(hpred[col & 1] + min) >= max)
           derror();
-        RAW(row, col) = curve[LIM((short)hpred[col & 1], 0, 0x3fff)];
+        RAW(row, col) = hpred[col & 1];
       }
     }
   }
   catch (...)
   {
+    nikon_apply_curve(band, &RAW(row, col));
     free(huff);
     throw;
   }
+  nikon_apply_curve(band, &RAW(row, 0));
   free(huff);
 }
 
+/* Map predicted values in [from, to) through curve[], as nikon_load_raw()
+   would have stored them */
+void LibRaw::nikon_apply_curve(ushort *from, ushort *to)
+{
+  INT64 n = to - from, i;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(i)
+#endif
+  for (i = 0; i < n; i++)
+    from[i] = curve[LIM((short)from[i], 0, 0x3fff)];
+}
+
 void LibRaw::nikon_yuv_load_raw()
 {
   if (!image)
@@ -1124,6 +1396,96 @@ unsigned LibRaw::pana_data(int nb, unsigned *bytes)
 #endif
 }
 
+/* Unpack one 16-byte Panasonic encoding 5 block into 10 (12-bit) or
+   9 (14-bit) pixels */
+static void pana5_unpack(const unsigned *bytes, ushort *raw_block_data,
+                         int bpp)
+{
+  if (bpp == 12)
+  {
+    raw_block_data[0] = ((bytes[1] & 0xF) << 8) + bytes[0];
+    raw_block_data[1] = 16 * bytes[2] + (bytes[1] >> 4);
+    raw_block_data[2] = ((bytes[4] & 0xF) << 8) + bytes[3];
+    raw_block_data[3] = 16 * bytes[5] + (bytes[4] >> 4);
+    raw_block_data[4] = ((bytes[7] & 0xF) << 8) + bytes[6];
+    raw_block_data[5] = 16 * bytes[8] + (bytes[7] >> 4);
+    raw_block_data[6] = ((bytes[10] & 0xF) << 8) + bytes[9];
+    raw_block_data[7] = 16 * bytes[11] + (bytes[10] >> 4);
+    raw_block_data[8] = ((bytes[13] & 0xF) << 8) + bytes[12];
+    raw_block_data[9] = 16 * bytes[14] + (bytes[13] >> 4);
+  }
+  else if (bpp == 14)
+  {
+    raw_block_data[0] = bytes[0] + ((bytes[1] & 0x3F) << 8);
+    raw_block_data[1] =
+        (bytes[1] >> 6) + 4 * (bytes[2]) + ((bytes[3] & 0xF) << 10);
+    raw_block_data[2] =
+        (bytes[3] >> 4) + 16 * (bytes[4]) + ((bytes[5] & 3) << 12);
+    raw_block_data[3] = ((bytes[5] & 0xFC) >> 2) + (bytes[6] << 6);
+    raw_block_data[4] = bytes[7] + ((bytes[8] & 0x3F) << 8);
+    raw_block_data[5] =
+        (bytes[8] >> 6) + 4 * bytes[9] + ((bytes[10] & 0xF) << 10);
+    raw_block_data[6] =
+        (bytes[10] >> 4) + 16 * bytes[11] + ((bytes[12] & 3) << 12);
+    raw_block_data[7] =
+        ((bytes[12] & 0xFC) >> 2) + (bytes[13] << 6);
+    raw_block_data[8] = bytes[14] + ((bytes[15] & 0x3F) << 8);
+  }
+}
+
+/*
+   Encoding 5 stores fixed 16-byte blocks in 0x4000-byte chunks (rotated by
+   load_flags), so the chunk and offset of every block are known up front.
+   Rows that end on a block boundary are decoded in parallel from chunks
+   read LIBRAW_RAW_BAND rows at a time.  Returns 0 if the file does not
+   fit this layout and the serial pana_data() loop has to be used.
+ */
+int LibRaw::panasonic5_load_raw_parallel()
+{
+#ifdef LIBRAW_USE_OPENMP
+  int enc_blck_size = pana_bpp == 12 ? 10 : 9;
+  int bpr = raw_width / enc_blck_size, row;
+  INT64 start = ftell(ifp);
+  INT64 nchunks = (INT64(raw_height) * bpr + 1023) >> 10;
+
+  if (raw_width % enc_blck_size || load_flags >= 0x4000 || !raw_height ||
+      start + nchunks * 0x4000 > ifp->size())
+    return 0;
+
+  std::vector<uchar> chunks(
+      (((size_t(LIBRAW_RAW_BAND) * bpr + 1022) >> 10) + 1) * 0x4000);
+  for (int row0 = 0; row0 < raw_height; row0 += LIBRAW_RAW_BAND)
+  {
+    int rows = MIN(LIBRAW_RAW_BAND, raw_height - row0);
+    INT64 c0 = (INT64(row0) * bpr) >> 10;
+    INT64 c1 = (INT64(row0 + rows) * bpr - 1) >> 10;
+    checkCancel();
+    fseek(ifp, start + c0 * 0x4000, SEEK_SET);
+    fread(chunks.data(), 0x4000, c1 - c0 + 1, ifp);
+#pragma omp parallel for schedule(static) default(shared) private(row)
+    for (row = row0; row < row0 + rows; row++)
+    {
+      unsigned bytes[16];
+      INT64 blk = INT64(row) * bpr;
+      for (int col = 0, c; col < raw_width; col += enc_blck_size, blk++)
+      {
+        const uchar *chunk = chunks.data() + ((blk >> 10) - c0) * 0x4000;
+        int pos = (int(blk & 1023) * 16 - load_flags) & 0x3FFF;
+        if (pos <= 0x4000 - 16)
+          FORC(16) bytes[c] = chunk[pos + c];
+        else
+          FORC(16) bytes[c] = chunk[(pos + c) & 0x3FFF];
+        pana5_unpack(bytes, raw_image + row * raw_width + col, pana_bpp);
+      }
+    }
+  }
+  fseek(ifp, start + nchunks * 0x4000, SEEK_SET);
+  return 1;
+#else
+  return 0;
+#endif
+}
+
 void LibRaw::panasonic_load_raw()
 {
   int row, col, i, j, sh = 0, pred[2], nonz[2];
@@ -1136,6 +1498,8 @@ void LibRaw::panasonic_load_raw()
   int enc_blck_size = pana_bpp == 12 ? 10 : 9;
   if (pana_encoding == 5)
   {
+    if (panasonic5_load_raw_parallel())
+      return;
     for (row = 0; row < raw_height; row++)
     {
       raw_block_data = raw_image + row * raw_width;
@@ -1143,37 +1507,7 @@ void LibRaw::panasonic_load_raw()
       for (col = 0; col < raw_width; col += enc_blck_size)
       {
         pana_data(0, bytes);
-
-        if (pana_bpp == 12)
-        {
-          raw_block_data[col] = ((bytes[1] & 0xF) << 8) + bytes[0];
-          raw_block_data[col + 1] = 16 * bytes[2] + (bytes[1] >> 4);
-          raw_block_data[col + 2] = ((bytes[4] & 0xF) << 8) + bytes[3];
-          raw_block_data[col + 3] = 16 * bytes[5] + (bytes[4] >> 4);
-          raw_block_data[col + 4] = ((bytes[7] & 0xF) << 8) + bytes[6];
-          raw_block_data[col + 5] = 16 * bytes[8] + (bytes[7] >> 4);
-          raw_block_data[col + 6] = ((bytes[10] & 0xF) << 8) + bytes[9];
-          raw_block_data[col + 7] = 16 * bytes[11] + (bytes[10] >> 4);
-          raw_block_data[col + 8] = ((bytes[13] & 0xF) << 8) + bytes[12];
-          raw_block_data[col + 9] = 16 * bytes[14] + (bytes[13] >> 4);
-        }
-        else if (pana_bpp == 14)
-        {
-          raw_block_data[col] = bytes[0] + ((bytes[1] & 0x3F) << 8);
-          raw_block_data[col + 1] =
-              (bytes[1] >> 6) + 4 * (bytes[2]) + ((bytes[3] & 0xF) << 10);
-          raw_block_data[col + 2] =
-              (bytes[3] >> 4) + 16 * (bytes[4]) + ((bytes[5] & 3) << 12);
-          raw_block_data[col + 3] = ((bytes[5] & 0xFC) >> 2) + (bytes[6] << 6);
-          raw_block_data[col + 4] = bytes[7] + ((bytes[8] & 0x3F) << 8);
-          raw_block_data[col + 5] =
-              (bytes[8] >> 6) + 4 * bytes[9] + ((bytes[10] & 0xF) << 10);
-          raw_block_data[col + 6] =
-              (bytes[10] >> 4) + 16 * bytes[11] + ((bytes[12] & 3) << 12);
-          raw_block_data[col + 7] =
-              ((bytes[12] & 0xFC) >> 2) + (bytes[13] << 6);
-          raw_block_data[col + 8] = bytes[14] + ((bytes[15] & 0x3F) << 8);
-        }
+        pana5_unpack(bytes, raw_block_data + col, pana_bpp);
       }
     }
   }
@@ -1232,7 +1566,7 @@ void LibRaw::olympus_load_raw()
         ;
       low = (sign = getbits(3)) & 3;
       sign = sign << 29 >> 31;
-      if ((high = getbithuff(12, huff)) == 12)
+      if ((high = getbithuff_fast(12, huff)) == 12)
         high = getbits(16 - nbits) >> 1;
       carry[0] = (high << nbits) | getbits(nbits);
       diff = (carry[0] ^ sign) + carry[1];
@@ -1445,9 +1779,11 @@ void LibRaw::sony_arw_load_raw()
                                  0x405, 0x304, 0x303, 0x300, 0x202, 0x201};
   int i, c, n, col, row, sum = 0;
 
+  std::vector<int> fast(1 + (1 << LIBRAW_HUFF_LOOKAHEAD));
   huff[0] = 15;
   for (n = i = 0; i < 18; i++)
     FORC(32768 >> (tab[i] >> 8)) huff[++n] = tab[i];
+  make_lookahead(huff, &fast[0], 0);
   getbits(-1);
   for (col = raw_width; col--;)
   {
@@ -1456,7 +1792,7 @@ void LibRaw::sony_arw_load_raw()
     {
       if (row == raw_height)
         row = 1;
-      if ((sum += ljpeg_diff(huff)) >> 12)
+      if ((sum += ljpeg_diff_fast(huff, &fast[0])) >> 12)
         derror();
       if (row < height)
         RAW(row, col) = sum;
@@ -1464,110 +1800,167 @@ void LibRaw::sony_arw_load_raw()
   }
 }
 
-void LibRaw::sony_arw2_load_raw()
+/*
+   Decode one ARW2 row of raw_width bytes (plus one readable byte after it).
+   Rows are independent, so this may run for several rows at once.
+ */
+void LibRaw::sony_arw2_row(uchar *data, int row)
 {
-  uchar *data, *dp;
-  ushort pix[16];
-  int row, col, val, max, min, imax, imin, sh, bit, i;
+  uchar *dp;
+  ushort pix[16], delta[16] = {0};
+  int col, val, max, min, imax, imin, sh, bit, i;
+  int plain = order == 0x4949 &&
+              !(imgdata.rawparams.specials & LIBRAW_RAWSPECIAL_SONYARW2_ALLFLAGS);
 
-  data = (uchar *)malloc(raw_width + 1);
-  try
+  for (dp = data, col = 0; col < raw_width - 30; dp += 16)
   {
-    for (row = 0; row < height; row++)
+    max = 0x7ff & (val = sget4(dp));
+    min = 0x7ff & val >> 11;
+    imax = 0x0f & val >> 22;
+    imin = 0x0f & val >> 26;
+    for (sh = 0; sh < 4 && 0x80 << sh <= max - min; sh++)
+      ;
+    if (plain && imax != imin)
     {
-      checkCancel();
-      fread(data, 1, raw_width, ifp);
-      for (dp = data, col = 0; col < raw_width - 30; dp += 16)
+      /* 14 deltas of 7 bits from bit 30 on, unpacked from two 64-bit words
+         without branches; pix[i] takes delta i less the skipped slots */
+      UINT64 lo = 0, hi = 0;
+      for (i = 8; i--;)
       {
-        max = 0x7ff & (val = sget4(dp));
-        min = 0x7ff & val >> 11;
-        imax = 0x0f & val >> 22;
-        imin = 0x0f & val >> 26;
-        for (sh = 0; sh < 4 && 0x80 << sh <= max - min; sh++)
-          ;
-        /* flag checks if outside of loop */
-        if (!(imgdata.rawparams.specials & LIBRAW_RAWSPECIAL_SONYARW2_ALLFLAGS) // no flag set
-            || (imgdata.rawparams.specials & LIBRAW_RAWSPECIAL_SONYARW2_DELTATOVALUE))
-        {
-          for (bit = 30, i = 0; i < 16; i++)
-            if (i == imax)
-              pix[i] = max;
-            else if (i == imin)
-              pix[i] = min;
-            else
-            {
-              pix[i] =
-                  ((sget2(dp + (bit >> 3)) >> (bit & 7) & 0x7f) << sh) + min;
-              if (pix[i] > 0x7ff)
-                pix[i] = 0x7ff;
-              bit += 7;
-            }
-        }
-        else if (imgdata.rawparams.specials & LIBRAW_RAWSPECIAL_SONYARW2_BASEONLY)
+        lo = lo << 8 | dp[i];
+        hi = hi << 8 | dp[i + 8];
+      }
+      for (i = 0; i < 5; i++)
+        delta[i] = (lo >> (30 + 7 * i) | hi << (34 - 7 * i)) & 0x7f;
+      for (; i < 14; i++)
+        delta[i] = hi >> (7 * i - 34) & 0x7f;
+      for (i = 0; i < 16; i++)
+      {
+        val = (delta[i - (i > imax) - (i > imin)] << sh) + min;
+        pix[i] = i == imax ? max : i == imin ? min : MIN(val, 0x7ff);
+      }
+    }
+    /* flag checks if outside of loop */
+    else if (!(imgdata.rawparams.specials & LIBRAW_RAWSPECIAL_SONYARW2_ALLFLAGS) // no flag set
+        || (imgdata.rawparams.specials & LIBRAW_RAWSPECIAL_SONYARW2_DELTATOVALUE))
+    {
+      for (bit = 30, i = 0; i < 16; i++)
+        if (i == imax)
+          pix[i] = max;
+        else if (i == imin)
+          pix[i] = min;
+        else
         {
-          for (bit = 30, i = 0; i < 16; i++)
-            if (i == imax)
-              pix[i] = max;
-            else if (i == imin)
-              pix[i] = min;
-            else
-              pix[i] = 0;
+          pix[i] =
+              ((sget2(dp + (bit >> 3)) >> (bit & 7) & 0x7f) << sh) + min;
+          if (pix[i] > 0x7ff)
+            pix[i] = 0x7ff;
+          bit += 7;
         }
-        else if (imgdata.rawparams.specials & LIBRAW_RAWSPECIAL_SONYARW2_DELTAONLY)
+    }
+    else if (imgdata.rawparams.specials & LIBRAW_RAWSPECIAL_SONYARW2_BASEONLY)
+    {
+      for (bit = 30, i = 0; i < 16; i++)
+        if (i == imax)
+          pix[i] = max;
+        else if (i == imin)
+          pix[i] = min;
+        else
+          pix[i] = 0;
+    }
+    else if (imgdata.rawparams.specials & LIBRAW_RAWSPECIAL_SONYARW2_DELTAONLY)
+    {
+      for (bit = 30, i = 0; i < 16; i++)
+        if (i == imax)
+          pix[i] = 0;
+        else if (i == imin)
+          pix[i] = 0;
+        else
         {
-          for (bit = 30, i = 0; i < 16; i++)
-            if (i == imax)
-              pix[i] = 0;
-            else if (i == imin)
-              pix[i] = 0;
-            else
-            {
-              pix[i] =
-                  ((sget2(dp + (bit >> 3)) >> (bit & 7) & 0x7f) << sh) + min;
-              if (pix[i] > 0x7ff)
-                pix[i] = 0x7ff;
-              bit += 7;
-            }
+          pix[i] =
+              ((sget2(dp + (bit >> 3)) >> (bit & 7) & 0x7f) << sh) + min;
+          if (pix[i] > 0x7ff)
+            pix[i] = 0x7ff;
+          bit += 7;
         }
-        else if (imgdata.rawparams.specials & LIBRAW_RAWSPECIAL_SONYARW2_DELTAZEROBASE)
+    }
+    else if (imgdata.rawparams.specials & LIBRAW_RAWSPECIAL_SONYARW2_DELTAZEROBASE)
+    {
+      for (bit = 30, i = 0; i < 16; i++)
+        if (i == imax)
+          pix[i] = 0;
+        else if (i == imin)
+          pix[i] = 0;
+        else
         {
-          for (bit = 30, i = 0; i < 16; i++)
-            if (i == imax)
-              pix[i] = 0;
-            else if (i == imin)
-              pix[i] = 0;
-            else
-            {
-              pix[i] = ((sget2(dp + (bit >> 3)) >> (bit & 7) & 0x7f) << sh);
-              if (pix[i] > 0x7ff)
-                pix[i] = 0x7ff;
-              bit += 7;
-            }
+          pix[i] = ((sget2(dp + (bit >> 3)) >> (bit & 7) & 0x7f) << sh);
+          if (pix[i] > 0x7ff)
+            pix[i] = 0x7ff;
+          bit += 7;
         }
+    }
 
-        if (imgdata.rawparams.specials & LIBRAW_RAWSPECIAL_SONYARW2_DELTATOVALUE)
-        {
-          for (i = 0; i < 16; i++, col += 2)
-          {
-            unsigned slope =
-                pix[i] < 1001 ? 2
-                              : curve[pix[i] << 1] - curve[(pix[i] << 1) - 2];
-            unsigned step = 1 << sh;
-            RAW(row, col) =
-                curve[pix[i] << 1] >
-                        black + imgdata.rawparams.sony_arw2_posterization_thr
-                    ? LIM(((slope * step * 1000) /
-                           (curve[pix[i] << 1] - black)),
-                          0, 10000)
-                    : 0;
-          }
-        }
-        else
-          for (i = 0; i < 16; i++, col += 2)
-            RAW(row, col) = curve[pix[i] << 1];
-        col -= col & 1 ? 1 : 31;
+    if (imgdata.rawparams.specials & LIBRAW_RAWSPECIAL_SONYARW2_DELTATOVALUE)
+    {
+      for (i = 0; i < 16; i++, col += 2)
+      {
+        unsigned slope =
+            pix[i] < 1001 ? 2
+                          : curve[pix[i] << 1] - curve[(pix[i] << 1) - 2];
+        unsigned step = 1 << sh;
+        RAW(row, col) =
+            curve[pix[i] << 1] >
+                    black + imgdata.rawparams.sony_arw2_posterization_thr
+                ? LIM(((slope * step * 1000) /
+                       (curve[pix[i] << 1] - black)),
+                      0, 10000)
+                : 0;
       }
     }
+    else
+      for (i = 0; i < 16; i++, col += 2)
+        RAW(row, col) = curve[pix[i] << 1];
+    col -= col & 1 ? 1 : 31;
+  }
+}
+
+void LibRaw::sony_arw2_load_raw()
+{
+  uchar *data;
+  int row;
+
+#ifdef LIBRAW_USE_OPENMP
+  INT64 start = ftell(ifp);
+  if (start + INT64(height) * raw_width <= ifp->size())
+  {
+    /* read LIBRAW_RAW_BAND rows, decode them in parallel; each row keeps
+       two zero bytes after it for blocks that read past the row end */
+    size_t stride = raw_width + 2;
+    std::vector<uchar> band(LIBRAW_RAW_BAND * stride);
+    for (int row0 = 0; row0 < height; row0 += LIBRAW_RAW_BAND)
+    {
+      int rows = MIN(LIBRAW_RAW_BAND, height - row0);
+      checkCancel();
+      for (row = 0; row < rows; row++)
+        fread(band.data() + row * stride, 1, raw_width, ifp);
+#pragma omp parallel for schedule(static) default(shared) private(row)
+      for (row = 0; row < rows; row++)
+        sony_arw2_row(band.data() + row * stride, row0 + row);
+    }
+    if (imgdata.rawparams.specials & LIBRAW_RAWSPECIAL_SONYARW2_DELTATOVALUE)
+      maximum = 10000;
+    return;
+  }
+#endif
+  data = (uchar *)malloc(raw_width + 1);
+  try
+  {
+    for (row = 0; row < height; row++)
+    {
+      checkCancel();
+      fread(data, 1, raw_width, ifp);
+      sony_arw2_row(data, row);
+    }
   }
   catch (...)
   {
@@ -1639,18 +2032,19 @@ void LibRaw::samsung2_load_raw()
                                  0x600, 0x709, 0x80a, 0x90b, 0xa0c,
                                  0xa0d, 0x501, 0x408, 0x402};
   ushort huff[1026], vpred[2][2] = {{0, 0}, {0, 0}}, hpred[2];
-  int i, c, n, row, col, diff;
+  int i, c, n, row, col, diff, fast[1 + (1 << 10)];
 
   huff[0] = 10;
   for (n = i = 0; i < 14; i++)
     FORC(1024 >> (tab[i] >> 8)) huff[++n] = tab[i];
+  make_lookahead(huff, fast, 0);
   getbits(-1);
   for (row = 0; row < raw_height; row++)
   {
     checkCancel();
     for (col = 0; col < raw_width; col++)
     {
-      diff = ljpeg_diff(huff);
+      diff = ljpeg_diff_fast(huff, &fast[0]);
       if (col < 2)
         hpred[col] = vpred[row & 1][col] += diff;
       else
@@ -194,17 +194,34 @@ void LibRaw::nikon_14bit_load_raw()
       (unsigned)(ceilf((float)(S.raw_width * 7 / 4) / 16.0)) *
       16; // 14512; // S.raw_width * 7 / 4;
   const unsigned pitch = S.raw_pitch ? S.raw_pitch / 2 : S.raw_width;
-  unsigned char *buf = (unsigned char *)malloc(linelen);
-  for (int row = 0; row < S.raw_height; row++)
+  LibRaw_abstract_datastream *input = libraw_internal_data.internal_data.input;
+  // whole bands are unpacked in parallel when all rows are in the file
+  const int band =
+      input->tell() + INT64(linelen) * S.raw_height <= input->size()
+          ? LIBRAW_RAW_BAND
+          : 1;
+  unsigned char *buf = (unsigned char *)malloc(size_t(linelen) * band);
+  for (int row0 = 0; row0 < S.raw_height; row0 += band)
   {
-    unsigned bytesread =
-        libraw_internal_data.internal_data.input->read(buf, 1, linelen);
-    unsigned short *dest = &imgdata.rawdata.raw_image[pitch * row];
-    // swab32arr((unsigned *)buf, bytesread / 4);
-    for (unsigned int sp = 0, dp = 0;
-         dp < pitch - 3 && sp < linelen - 6 && sp < bytesread - 6;
-         sp += 7, dp += 4)
-      unpack7bytesto4x16_nikon(buf + sp, dest + dp);
+    int rows = MIN(band, S.raw_height - row0), row;
+    unsigned bytesread = linelen;
+    if (band > 1)
+      input->read(buf, linelen, rows);
+    else
+      bytesread = input->read(buf, 1, linelen);
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(row) if (band > 1)
+#endif
+    for (row = 0; row < rows; row++)
+    {
+      unsigned char *src = buf + size_t(linelen) * row;
+      unsigned short *dest = &imgdata.rawdata.raw_image[pitch * (row0 + row)];
+      // swab32arr((unsigned *)buf, bytesread / 4);
+      for (unsigned int sp = 0, dp = 0;
+           dp < pitch - 3 && sp < linelen - 6 && sp < bytesread - 6;
+           sp += 7, dp += 4)
+        unpack7bytesto4x16_nikon(src + sp, dest + dp);
+    }
   }
   free(buf);
 }
@@ -243,19 +260,32 @@ void LibRaw::nikon_load_padded_packed_raw() // 12 bit per pixel, padded to 16
   if (libraw_internal_data.unpacker_data.load_flags < 2000 ||
       libraw_internal_data.unpacker_data.load_flags > 64000)
     return;
-  unsigned char *buf =
-      (unsigned char *)malloc(libraw_internal_data.unpacker_data.load_flags);
-  for (int row = 0; row < S.raw_height; row++)
+  const unsigned rowbytes = libraw_internal_data.unpacker_data.load_flags;
+  LibRaw_abstract_datastream *input = libraw_internal_data.internal_data.input;
+  // a short row keeps the previous row's tail, so bands need the whole image
+  const int band =
+      input->tell() + INT64(rowbytes) * S.raw_height <= input->size()
+          ? LIBRAW_RAW_BAND
+          : 1;
+  unsigned char *buf = (unsigned char *)malloc(size_t(rowbytes) * band);
+  for (int row0 = 0; row0 < S.raw_height; row0 += band)
   {
     checkCancel();
-    libraw_internal_data.internal_data.input->read(
-        buf, libraw_internal_data.unpacker_data.load_flags, 1);
-    for (int icol = 0; icol < S.raw_width / 2; icol++)
+    int rows = MIN(band, S.raw_height - row0), row;
+    input->read(buf, rowbytes, rows);
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(row) if (band > 1)
+#endif
+    for (row = 0; row < rows; row++)
     {
-      imgdata.rawdata.raw_image[(row)*S.raw_width + (icol * 2)] =
-          ((buf[icol * 3 + 1] & 0xf) << 8) | buf[icol * 3];
-      imgdata.rawdata.raw_image[(row)*S.raw_width + (icol * 2 + 1)] =
-          buf[icol * 3 + 2] << 4 | ((buf[icol * 3 + 1] & 0xf0) >> 4);
+      unsigned char *src = buf + size_t(rowbytes) * row;
+      ushort *dest = &imgdata.rawdata.raw_image[(row0 + row) * S.raw_width];
+      for (int icol = 0; icol < S.raw_width / 2; icol++)
+      {
+        dest[icol * 2] = ((src[icol * 3 + 1] & 0xf) << 8) | src[icol * 3];
+        dest[icol * 2 + 1] =
+            src[icol * 3 + 2] << 4 | ((src[icol * 3 + 1] & 0xf0) >> 4);
+      }
     }
   }
   free(buf);
@@ -286,6 +316,65 @@ void LibRaw::nikon_load_striped_packed_raw()
   if (load_flags & 1)
     bwide = bwide * 16 / 15;
   bite = 8 + (load_flags & 24);
+
+  // Rows that fill whole 32-bit words start each on a fresh word, so once
+  // every strip is known to be in the file they are unpacked in parallel.
+  bool parallel = !rbits && !(S.raw_width * tiff_bps % bite);
+  for (i = 0; parallel && i < ifd->strip_offsets_count &&
+              i * ifd->rows_per_strip < S.raw_height;
+       i++)
+    parallel = ifd->strip_offsets[i] >= 0 &&
+               ifd->strip_offsets[i] +
+                       INT64(bwide) *
+                           MIN(ifd->rows_per_strip,
+                               S.raw_height - i * ifd->rows_per_strip) <=
+                   libraw_internal_data.internal_data.input->size();
+  if (parallel)
+  {
+    unsigned char *buf =
+        (unsigned char *)malloc(size_t(bwide) * LIBRAW_RAW_BAND);
+    for (int row0 = 0; row0 < S.raw_height; row0 += LIBRAW_RAW_BAND)
+    {
+      checkCancel();
+      int rows = MIN(LIBRAW_RAW_BAND, S.raw_height - row0);
+      for (row = 0; row < rows; row++)
+      {
+        if (!((row0 + row) % ifd->rows_per_strip))
+        {
+          if (stripcnt >= ifd->strip_offsets_count)
+            break; // run out of data
+          libraw_internal_data.internal_data.input->seek(
+              ifd->strip_offsets[stripcnt], SEEK_SET);
+          stripcnt++;
+        }
+        libraw_internal_data.internal_data.input->read(buf + size_t(bwide) * row,
+                                                       1, bwide);
+      }
+      rows = row;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(row, col, i)
+#endif
+      for (row = 0; row < rows; row++)
+      {
+        unsigned char *src = buf + size_t(bwide) * row;
+        ushort *dest = &imgdata.rawdata.raw_image[(row0 + row) * S.raw_width];
+        UINT64 rbuf = 0;
+        int rvbits = 0;
+        for (col = 0; col < S.raw_width; col++)
+        {
+          for (rvbits -= tiff_bps; rvbits < 0; rvbits += bite, src += 4)
+            rbuf = rbuf << bite | src[0] | src[1] << 8 | src[2] << 16 |
+                   unsigned(src[3]) << 24;
+          dest[col] = rbuf << (64 - tiff_bps - rvbits) >> (64 - tiff_bps);
+        }
+      }
+      if (rows < MIN(LIBRAW_RAW_BAND, S.raw_height - row0))
+        break;
+    }
+    free(buf);
+    return;
+  }
+
   for (row = 0; row < S.raw_height; row++)
   {
     checkCancel();
@@ -384,6 +473,20 @@ void pana_cs6_page_decoder::read_page12()
   lastoffset += 16;
 }
 
+/*
+   Panasonic C6/C7 rows are made of independent 16-byte blocks.  When the
+   whole data is in the file, rows are read LIBRAW_RAW_BAND at a time
+   and decoded in parallel; otherwise 16 rows are read at a time as before
+   so that a short file fails at the same place.
+ */
+int LibRaw::panasonicC_band(int rowbytes, int rows)
+{
+  LibRaw_abstract_datastream *input = libraw_internal_data.internal_data.input;
+  return input->tell() + INT64(rowbytes) * rows <= input->size()
+             ? LIBRAW_RAW_BAND
+             : 16;
+}
+
 void LibRaw::panasonicC6_load_raw()
 {
   const int rowstep = 16;
@@ -395,77 +498,90 @@ void LibRaw::panasonicC6_load_raw()
   const unsigned pixelbase_compare = _12bit ? 0x800 : 0x2000;
   const unsigned spix_compare = _12bit ? 0x3fff : 0xffff;
   const unsigned pixel_mask = _12bit ? 0xfff : 0x3fff;
+  const int nrows = imgdata.sizes.raw_height / rowstep * rowstep;
+  const int band = panasonicC_band(rowbytes, nrows);
   std::vector<unsigned char> iobuf;
   try
   {
-      iobuf.resize(rowbytes * rowstep);
+      iobuf.resize(rowbytes * band);
   }
   catch (...)
   {
     throw LIBRAW_EXCEPTION_ALLOC;
   }
 
-  for (int row = 0; row < imgdata.sizes.raw_height - rowstep + 1;
-       row += rowstep)
+  for (int row = 0; row < nrows; row += band)
   {
-    int rowstoread = MIN(rowstep, imgdata.sizes.raw_height - row);
+    int rowstoread = MIN(band, nrows - row), crow, err = 0;
     if (libraw_internal_data.internal_data.input->read(
             iobuf.data(), rowbytes, rowstoread) != rowstoread)
       throw LIBRAW_EXCEPTION_IO_EOF;
-    pana_cs6_page_decoder page(iobuf.data(), rowbytes * rowstoread);
-    for (int crow = 0, col = 0; crow < rowstoread; crow++, col = 0)
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(crow)
+#endif
+    for (crow = 0; crow < rowstoread; crow++)
     {
+      pana_cs6_page_decoder page(iobuf.data() + crow * rowbytes, rowbytes);
       unsigned short *rowptr =
           &imgdata.rawdata
                .raw_image[(row + crow) * imgdata.sizes.raw_pitch / 2];
-      for (int rblock = 0; rblock < blocksperrow; rblock++)
+      try
       {
-          if (_12bit)
-              page.read_page12();
-          else
-              page.read_page();
-        unsigned oddeven[2] = {0, 0}, nonzero[2] = {0, 0};
-        unsigned pmul = 0, pixel_base = 0;
-        for (int pix = 0; pix < pixperblock; pix++)
+        for (int rblock = 0, col = 0; rblock < blocksperrow; rblock++)
         {
-          if (pix % 3 == 2)
-          {
-            unsigned base = _12bit ? page.nextpixel12(): page.nextpixel();
-            if (base > 3)
-              throw LIBRAW_EXCEPTION_IO_CORRUPT; // not possible b/c of 2-bit
-                                                 // field, but....
-            if (base == 3)
-              base = 4;
-            pixel_base = pixelbase0 << base;
-            pmul = 1 << base;
-          }
-          unsigned epixel = _12bit ? page.nextpixel12() : page.nextpixel();
-          if (oddeven[pix % 2])
-          {
-            epixel *= pmul;
-            if (pixel_base < pixelbase_compare && nonzero[pix % 2] > pixel_base)
-              epixel += nonzero[pix % 2] - pixel_base;
-            nonzero[pix % 2] = epixel;
-          }
+          if (_12bit)
+            page.read_page12();
           else
+            page.read_page();
+          unsigned oddeven[2] = {0, 0}, nonzero[2] = {0, 0};
+          unsigned pmul = 0, pixel_base = 0;
+          for (int pix = 0; pix < pixperblock; pix++)
           {
-            oddeven[pix % 2] = epixel;
-            if (epixel)
+            if (pix % 3 == 2)
+            {
+              unsigned base = _12bit ? page.nextpixel12(): page.nextpixel();
+              if (base > 3)
+                throw LIBRAW_EXCEPTION_IO_CORRUPT; // not possible b/c of 2-bit
+                                                   // field, but....
+              if (base == 3)
+                base = 4;
+              pixel_base = pixelbase0 << base;
+              pmul = 1 << base;
+            }
+            unsigned epixel = _12bit ? page.nextpixel12() : page.nextpixel();
+            if (oddeven[pix % 2])
+            {
+              epixel *= pmul;
+              if (pixel_base < pixelbase_compare && nonzero[pix % 2] > pixel_base)
+                epixel += nonzero[pix % 2] - pixel_base;
               nonzero[pix % 2] = epixel;
+            }
             else
-              epixel = nonzero[pix % 2];
-          }
-          unsigned spix = epixel - 0xf;
-          if (spix <= spix_compare)
-            rowptr[col++] = spix & spix_compare;
-          else
-          {
-            epixel = (((signed int)(epixel + 0x7ffffff1)) >> 0x1f);
-            rowptr[col++] = epixel & pixel_mask;
+            {
+              oddeven[pix % 2] = epixel;
+              if (epixel)
+                nonzero[pix % 2] = epixel;
+              else
+                epixel = nonzero[pix % 2];
+            }
+            unsigned spix = epixel - 0xf;
+            if (spix <= spix_compare)
+              rowptr[col++] = spix & spix_compare;
+            else
+            {
+              epixel = (((signed int)(epixel + 0x7ffffff1)) >> 0x1f);
+              rowptr[col++] = epixel & pixel_mask;
+            }
           }
         }
       }
+      catch (LibRaw_exceptions e)
+      {
+        err = e;
+      }
     }
+    if (err)
+      throw (LibRaw_exceptions)err;
   }
 }
 
@@ -475,17 +591,21 @@ void LibRaw::panasonicC7_load_raw()
   const int rowstep = 16;
   int pixperblock = libraw_internal_data.unpacker_data.pana_bpp == 14 ? 9 : 10;
   int rowbytes = imgdata.sizes.raw_width / pixperblock * 16;
-  unsigned char *iobuf = (unsigned char *)malloc(rowbytes * rowstep);
-  for (int row = 0; row < imgdata.sizes.raw_height - rowstep + 1;
-       row += rowstep)
+  const int nrows = imgdata.sizes.raw_height / rowstep * rowstep;
+  const int band = panasonicC_band(rowbytes, nrows);
+  std::vector<unsigned char> iobuf(rowbytes * band);
+  for (int row = 0; row < nrows; row += band)
   {
-    int rowstoread = MIN(rowstep, imgdata.sizes.raw_height - row);
+    int rowstoread = MIN(band, nrows - row), crow;
     if (libraw_internal_data.internal_data.input->read(
-            iobuf, rowbytes, rowstoread) != rowstoread)
+            iobuf.data(), rowbytes, rowstoread) != rowstoread)
       throw LIBRAW_EXCEPTION_IO_EOF;
-    unsigned char *bytes = iobuf;
-    for (int crow = 0; crow < rowstoread; crow++)
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(crow)
+#endif
+    for (crow = 0; crow < rowstoread; crow++)
     {
+      unsigned char *bytes = iobuf.data() + crow * rowbytes;
       unsigned short *rowptr =
           &imgdata.rawdata
                .raw_image[(row + crow) * imgdata.sizes.raw_pitch / 2];
@@ -525,7 +645,6 @@ void LibRaw::panasonicC7_load_raw()
       }
     }
   }
-  free(iobuf);
 }
 
 void LibRaw::unpacked_load_raw_fuji_f700s20()
@@ -818,6 +937,16 @@ void decode_S_type(int32_t out_width, uint32_t *img_input, ushort *outbuf /*, in
 	}
 }
 
+static void decode_S_rows(int32_t out_width, uint8_t *data, INT64 slotsz, ushort **outbufs, int rows)
+{
+	int i;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(i)
+#endif
+	for (i = 0; i < rows; i++)
+		decode_S_type(out_width, (uint32_t *)(data + slotsz * i), outbufs[i] /*, 14 */);
+}
+
 struct p1_row_info_t
 {
 	unsigned row;
@@ -842,20 +971,44 @@ void LibRaw::phase_one_load_raw_s()
 	stripes[imgdata.sizes.raw_height].offset = libraw_internal_data.unpacker_data.data_offset + INT64(libraw_internal_data.unpacker_data.data_size);
 	std::sort(stripes.begin(), stripes.end());
 	INT64 maxsz = imgdata.sizes.raw_width * 3 + 2; // theor max: 17 bytes per 8 pix + row header
-	std::vector<uint8_t> datavec(maxsz);
-
-	for (unsigned row = 0; row < imgdata.sizes.raw_height; row++)
+	// Rows are read in file order a band at a time and decoded in parallel.
+	// A slot's tail is copied from the previous slot, so every row sees the
+	// same bytes the single reused row buffer would have held.
+	const INT64 slotsz = (maxsz + 3) & ~INT64(3);
+	std::vector<uint8_t> datavec(slotsz * LIBRAW_RAW_BAND);
+	ushort *datap[LIBRAW_RAW_BAND];
+	uint8_t *prev = 0;
+
+	for (unsigned row0 = 0; row0 < imgdata.sizes.raw_height; row0 += LIBRAW_RAW_BAND)
 	{
-		if (stripes[row].row >= imgdata.sizes.raw_height) continue; 
-		ushort *datap = imgdata.rawdata.raw_image + stripes[row].row * imgdata.sizes.raw_width;
-		libraw_internal_data.internal_data.input->seek(stripes[row].offset, SEEK_SET);
-		INT64 readsz = stripes[row + 1].offset - stripes[row].offset;
-		if (readsz > maxsz)
-			throw LIBRAW_EXCEPTION_IO_CORRUPT;
-
-		if(libraw_internal_data.internal_data.input->read(datavec.data(), 1, readsz) != readsz)
-			derror(); // TODO: check read state
-
-		decode_S_type(imgdata.sizes.raw_width, (uint32_t *)datavec.data(), datap /*, 14 */);
+		unsigned rows = MIN(LIBRAW_RAW_BAND, imgdata.sizes.raw_height - row0);
+		int nread = 0;
+		try
+		{
+			for (unsigned row = row0; row < row0 + rows; row++)
+			{
+				if (stripes[row].row >= imgdata.sizes.raw_height) continue; 
+				uint8_t *slot = datavec.data() + slotsz * nread;
+				libraw_internal_data.internal_data.input->seek(stripes[row].offset, SEEK_SET);
+				INT64 readsz = stripes[row + 1].offset - stripes[row].offset;
+				if (readsz > maxsz)
+					throw LIBRAW_EXCEPTION_IO_CORRUPT;
+
+				INT64 got = libraw_internal_data.internal_data.input->read(slot, 1, readsz);
+				if (prev)
+					memmove(slot + got, prev + got, maxsz - got);
+				prev = slot;
+				if (got != readsz)
+					derror(); // TODO: check read state
+
+				datap[nread++] = imgdata.rawdata.raw_image + stripes[row].row * imgdata.sizes.raw_width;
+			}
+		}
+		catch (...)
+		{
+			decode_S_rows(imgdata.sizes.raw_width, datavec.data(), slotsz, datap, nread);
+			throw;
+		}
+		decode_S_rows(imgdata.sizes.raw_width, datavec.data(), slotsz, datap, nread);
 	}
 }
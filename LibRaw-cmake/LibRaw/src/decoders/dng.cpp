@@ -46,84 +46,172 @@ void LibRaw::adobe_copy_pixel(unsigned row, unsigned col, ushort **rp)
   if (tiff_samples == 2 && shot_select)
     (*rp)--;
 }
-void LibRaw::lossless_dng_load_raw()
+/*
+   Nonzero if the lossless JPEG tile with header jh can be decoded by a
+   parallel worker: 0xc3 only, and not spilling outside its own area.
+ */
+int LibRaw::lossless_dng_tile_fits(struct jhead *jh)
 {
-  unsigned trow = 0, tcol = 0, jwide, jrow, jcol, row, col, i, j;
-  INT64 save;
+  unsigned jwide = jh->wide;
+  if (filters)
+    jwide *= jh->clrs;
+  if (filters && (tiff_samples == 2)) // Fuji Super CCD
+    jwide /= 2;
+  return jh->algo == 0xc3 &&
+         (INT64(jh->high) *
+              (tiff_samples == 1 && jh->clrs > 1 && jh->clrs * jwide == raw_width
+                   ? jwide * jh->clrs
+                   : jwide) +
+          MIN(tile_width, raw_width) - 1) /
+                 MIN(tile_width, raw_width) <=
+             tile_length;
+}
+
+/*
+   Decode the lossless JPEG tile at dec's stream position into (trow, tcol).
+   Returns 0 if there is no JPEG header.  A parallel worker (dec != this)
+   gets -1 for tiles lossless_dng_tile_fits() refuses.
+ */
+int LibRaw::lossless_dng_tile(LibRaw *dec, unsigned trow, unsigned tcol,
+                              void *)
+{
+  unsigned jwide, jrow, jcol, row, col, i, j;
   struct jhead jh;
   ushort *rp;
 
+  if (!dec->ljpeg_start(&jh, 0))
+    return 0;
+  jwide = jh.wide;
+  if (filters)
+    jwide *= jh.clrs;
+
+  if(filters && (tiff_samples == 2)) // Fuji Super CCD
+      jwide /= 2;
+  if (dec != this && !lossless_dng_tile_fits(&jh))
+  {
+    dec->ljpeg_end(&jh);
+    return -1;
+  }
+  try
+  {
+    switch (jh.algo)
+    {
+    case 0xc1:
+      jh.vpred[0] = 16384;
+      dec->getbits(-1);
+      for (jrow = 0; jrow + 7 < (unsigned)jh.high; jrow += 8)
+      {
+        dec->checkCancel();
+        for (jcol = 0; jcol + 7 < (unsigned)jh.wide; jcol += 8)
+        {
+          dec->ljpeg_idct(&jh);
+          rp = jh.idct;
+          row = trow + jcol / tile_width + jrow * 2;
+          col = tcol + jcol % tile_width;
+          for (i = 0; i < 16; i += 2)
+            for (j = 0; j < 8; j++)
+              adobe_copy_pixel(row + i, col + j, &rp);
+        }
+      }
+      break;
+    case 0xc3:
+      for (row = col = jrow = 0; jrow < (unsigned)jh.high; jrow++)
+      {
+        dec->checkCancel();
+        rp = dec->ljpeg_row(jrow, &jh);
+        if (tiff_samples == 1 && jh.clrs > 1 && jh.clrs * jwide == raw_width)
+          for (jcol = 0; jcol < jwide * jh.clrs; jcol++)
+          {
+            adobe_copy_pixel(trow + row, tcol + col, &rp);
+            if (++col >= tile_width || col >= raw_width)
+              row += 1 + (col = 0);
+          }
+        else
+          for (jcol = 0; jcol < jwide; jcol++)
+          {
+            adobe_copy_pixel(trow + row, tcol + col, &rp);
+            if (++col >= tile_width || col >= raw_width)
+              row += 1 + (col = 0);
+          }
+      }
+    }
+  }
+  catch (...)
+  {
+    dec->ljpeg_end(&jh);
+    throw;
+  }
+  dec->ljpeg_end(&jh);
+  return 1;
+}
+
+void LibRaw::lossless_dng_load_raw()
+{
+  unsigned trow = 0, tcol = 0;
+  INT64 save;
+
   int ss = shot_select;
   shot_select = libraw_internal_data.unpacker_data.dng_frames[LIM(ss,0,(LIBRAW_IFD_MAXCOUNT*2-1))] & 0xff;
 
-  while (trow < raw_height)
+  try
   {
-    checkCancel();
+#ifdef LIBRAW_USE_OPENMP
+    // files with 0xc1 or spilling tiles have them throughout: check the
+    // first tile before reading all of them in parallel
+    struct jhead jh;
+    int fits = 0, done;
     save = ftell(ifp);
     if (tile_length < INT_MAX)
+    {
       fseek(ifp, get4(), SEEK_SET);
-    if (!ljpeg_start(&jh, 0))
-      break;
-    jwide = jh.wide;
-    if (filters)
-      jwide *= jh.clrs;
-
-    if(filters && (tiff_samples == 2)) // Fuji Super CCD
-        jwide /= 2;
-    try
+      if (ljpeg_start(&jh, 0))
+      {
+        fits = lossless_dng_tile_fits(&jh);
+        ljpeg_end(&jh);
+      }
+      fseek(ifp, save, SEEK_SET);
+    }
+    if (fits && (done = dng_tiles_parallel(&LibRaw::lossless_dng_tile, 0)))
     {
-      switch (jh.algo)
+      unsigned tilesh = (raw_width + tile_width - 1) / tile_width;
+      fseek(ifp, save + 4 * INT64(done), SEEK_SET);
+      trow = done / tilesh * tile_length;
+      tcol = done % tilesh * tile_width;
+    }
+#endif
+    while (trow < raw_height)
+    {
+      checkCancel();
+      save = ftell(ifp);
+      if (tile_length < INT_MAX)
+        fseek(ifp, get4(), SEEK_SET);
+      if (!lossless_dng_tile(this, trow, tcol, 0))
       {
-      case 0xc1:
-        jh.vpred[0] = 16384;
-        getbits(-1);
-        for (jrow = 0; jrow + 7 < (unsigned)jh.high; jrow += 8)
-        {
-          checkCancel();
-          for (jcol = 0; jcol + 7 < (unsigned)jh.wide; jcol += 8)
+#ifdef LIBRAW_USE_OPENMP
+        // tiles past this one were never decoded; clear what the parallel
+        // pass may have written there
+        for (unsigned row = trow, col; row < raw_height; row++)
+          if ((col = row < trow + tile_length ? tcol + tile_width : 0) <
+              raw_width)
           {
-            ljpeg_idct(&jh);
-            rp = jh.idct;
-            row = trow + jcol / tile_width + jrow * 2;
-            col = tcol + jcol % tile_width;
-            for (i = 0; i < 16; i += 2)
-              for (j = 0; j < 8; j++)
-                adobe_copy_pixel(row + i, col + j, &rp);
+            if (raw_image)
+              memset(&RAW(row, col), 0, (raw_width - col) * sizeof *raw_image);
+            else
+              memset(image[row * raw_width + col], 0,
+                     (raw_width - col) * sizeof *image);
           }
-        }
+#endif
         break;
-      case 0xc3:
-        for (row = col = jrow = 0; jrow < (unsigned)jh.high; jrow++)
-        {
-          checkCancel();
-          rp = ljpeg_row(jrow, &jh);
-          if (tiff_samples == 1 && jh.clrs > 1 && jh.clrs * jwide == raw_width)
-            for (jcol = 0; jcol < jwide * jh.clrs; jcol++)
-            {
-              adobe_copy_pixel(trow + row, tcol + col, &rp);
-              if (++col >= tile_width || col >= raw_width)
-                row += 1 + (col = 0);
-            }
-          else
-            for (jcol = 0; jcol < jwide; jcol++)
-            {
-              adobe_copy_pixel(trow + row, tcol + col, &rp);
-              if (++col >= tile_width || col >= raw_width)
-                row += 1 + (col = 0);
-            }
-        }
       }
+      fseek(ifp, save + 4, SEEK_SET);
+      if ((tcol += tile_width) >= raw_width)
+        trow += tile_length + (tcol = 0);
     }
-    catch (...)
-    {
-      ljpeg_end(&jh);
-      shot_select = ss;
-      throw;
-    }
-    fseek(ifp, save + 4, SEEK_SET);
-    if ((tcol += tile_width) >= raw_width)
-      trow += tile_length + (tcol = 0);
-    ljpeg_end(&jh);
+  }
+  catch (...)
+  {
+    shot_select = ss;
+    throw;
   }
   shot_select = ss;
 }
@@ -178,15 +266,66 @@ static void jpegErrorExit_d(j_common_ptr /*cinfo*/)
   throw LIBRAW_EXCEPTION_DECODE_JPEG;
 }
 
-void LibRaw::lossy_dng_load_raw()
+/*
+   Decode the JPEG tile at dec's stream position into (trow, tcol) of image,
+   through the cur[3][256] curves in data.  A parallel worker (dec != this)
+   gets -1 for tiles larger than their own area.
+ */
+int LibRaw::lossy_dng_tile(LibRaw *dec, unsigned trow, unsigned tcol,
+                           void *data)
 {
-  if (!image)
-    throw LIBRAW_EXCEPTION_IO_CORRUPT;
+  ushort(*cur)[256] = (ushort(*)[256])data;
   struct jpeg_decompress_struct cinfo;
+  struct jpeg_error_mgr pub;
   JSAMPARRAY buf;
   JSAMPLE(*pixel)[3];
+  unsigned row, col, c;
+
+  cinfo.err = jpeg_std_error(&pub);
+  pub.error_exit = jpegErrorExit_d;
+
+  jpeg_create_decompress(&cinfo);
+  try
+  {
+    if (dec->libraw_internal_data.internal_data.input->jpeg_src(&cinfo) == -1)
+      throw LIBRAW_EXCEPTION_DECODE_JPEG;
+    jpeg_read_header(&cinfo, TRUE);
+    jpeg_start_decompress(&cinfo);
+    if (dec != this && (cinfo.output_width > tile_width ||
+                        cinfo.output_height > tile_length))
+    {
+      jpeg_destroy_decompress(&cinfo);
+      return -1;
+    }
+    buf = (*cinfo.mem->alloc_sarray)((j_common_ptr)&cinfo, JPOOL_IMAGE,
+                                     cinfo.output_width * 3, 1);
+    while (cinfo.output_scanline < cinfo.output_height &&
+           (row = trow + cinfo.output_scanline) < height)
+    {
+      dec->checkCancel();
+      jpeg_read_scanlines(&cinfo, buf, 1);
+      pixel = (JSAMPLE(*)[3])buf[0];
+      for (col = 0; col < cinfo.output_width && tcol + col < width; col++)
+      {
+        FORC3 image[row * width + tcol + col][c] = cur[c][pixel[col][c]];
+      }
+    }
+  }
+  catch (...)
+  {
+    jpeg_destroy_decompress(&cinfo);
+    throw;
+  }
+  jpeg_destroy_decompress(&cinfo);
+  return 1;
+}
+
+void LibRaw::lossy_dng_load_raw()
+{
+  if (!image)
+    throw LIBRAW_EXCEPTION_IO_CORRUPT;
   unsigned sorder = order, ntags, opcode, deg, i, j, c;
-  unsigned trow = 0, tcol = 0, row, col;
+  unsigned trow = 0, tcol = 0;
   INT64 save = data_offset - 4;
   ushort cur[3][256];
   double coeff[9], tot;
@@ -229,50 +368,24 @@ void LibRaw::lossy_dng_load_raw()
     FORC3 memcpy(cur[c], curve, sizeof cur[0]);
   }
 
-  struct jpeg_error_mgr pub;
-  cinfo.err = jpeg_std_error(&pub);
-  pub.error_exit = jpegErrorExit_d;
-
-  jpeg_create_decompress(&cinfo);
-
+#ifdef LIBRAW_USE_OPENMP
+  if (int done = dng_tiles_parallel(&LibRaw::lossy_dng_tile, cur))
+  {
+    unsigned tilesh = (raw_width + tile_width - 1) / tile_width;
+    save += 4 * INT64(done);
+    trow = done / tilesh * tile_length;
+    tcol = done % tilesh * tile_width;
+  }
+#endif
   while (trow < raw_height)
   {
     fseek(ifp, save += 4, SEEK_SET);
     if (tile_length < INT_MAX)
       fseek(ifp, get4(), SEEK_SET);
-    if (libraw_internal_data.internal_data.input->jpeg_src(&cinfo) == -1)
-    {
-      jpeg_destroy_decompress(&cinfo);
-      throw LIBRAW_EXCEPTION_DECODE_JPEG;
-    }
-    jpeg_read_header(&cinfo, TRUE);
-    jpeg_start_decompress(&cinfo);
-    buf = (*cinfo.mem->alloc_sarray)((j_common_ptr)&cinfo, JPOOL_IMAGE,
-                                     cinfo.output_width * 3, 1);
-    try
-    {
-      while (cinfo.output_scanline < cinfo.output_height &&
-             (row = trow + cinfo.output_scanline) < height)
-      {
-        checkCancel();
-        jpeg_read_scanlines(&cinfo, buf, 1);
-        pixel = (JSAMPLE(*)[3])buf[0];
-        for (col = 0; col < cinfo.output_width && tcol + col < width; col++)
-        {
-          FORC3 image[row * width + tcol + col][c] = cur[c][pixel[col][c]];
-        }
-      }
-    }
-    catch (...)
-    {
-      jpeg_destroy_decompress(&cinfo);
-      throw;
-    }
-    jpeg_abort_decompress(&cinfo);
+    lossy_dng_tile(this, trow, tcol, cur);
     if ((tcol += tile_width) >= raw_width)
       trow += tile_length + (tcol = 0);
   }
-  jpeg_destroy_decompress(&cinfo);
   maximum = 0xffff;
 }
 #endif
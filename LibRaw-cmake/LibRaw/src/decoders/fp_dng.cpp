@@ -14,43 +14,22 @@
 
 #include "../../internal/libraw_cxx_defs.h"
 
+/*
+   Half float to float bits. Infinity becomes 65504 and NaN zero, like the
+   24-bit conversion below. Written without branches (denormals are scaled
+   as floats) so that row conversion vectorises.
+ */
 inline unsigned int __DNG_HalfToFloat(ushort halfValue)
 {
-  int sign = (halfValue >> 15) & 0x00000001;
-  int exponent = (halfValue >> 10) & 0x0000001f;
-  int mantissa = halfValue & 0x000003ff;
-  if (exponent == 0)
-  {
-    if (mantissa == 0)
-    {
-      return (unsigned int)(sign << 31);
-    }
-    else
-    {
-      while (!(mantissa & 0x00000400))
-      {
-        mantissa <<= 1;
-        exponent -= 1;
-      }
-      exponent += 1;
-      mantissa &= ~0x00000400;
-    }
-  }
-  else if (exponent == 31)
-  {
-    if (mantissa == 0)
-    {
-      return (unsigned int)((sign << 31) | ((0x1eL + 127 - 15) << 23) |
-                            (0x3ffL << 13));
-    }
-    else
-    {
-      return 0;
-    }
-  }
-  exponent += (127 - 15);
-  mantissa <<= 13;
-  return (unsigned int)((sign << 31) | (exponent << 23) | mantissa);
+  unsigned int sign = unsigned(halfValue & 0x8000) << 16;
+  unsigned int em = halfValue & 0x7fff, denormal;
+  float scaled = float(int(em)) * (1.f / 16777216.f);
+  memcpy(&denormal, &scaled, sizeof(denormal));
+  unsigned int isDenormal = 0u - (em < 0x400), isInf = 0u - (em == 0x7c00);
+  unsigned int isNormal = ~isDenormal & (0u - (em < 0x7c00));
+  unsigned int v = (denormal & isDenormal) | (((em << 13) + ((127 - 15) << 23)) & isNormal) |
+                   (0x477fe000 & isInf);
+  return (sign | v) & (isDenormal | isNormal | isInf);
 }
 
 inline unsigned int __DNG_FP24ToFloat(const unsigned char *input)
@@ -106,6 +85,20 @@ inline void DecodeDeltaBytes(unsigned char *bytePtr, int cols, int channels)
       bytePtr += 1;
     }
   }
+  else if (channels == 2)
+  {
+    unsigned char b0 = bytePtr[0];
+    unsigned char b1 = bytePtr[1];
+    bytePtr += 2;
+    for (int col = 1; col < cols; ++col)
+    {
+      b0 += bytePtr[0];
+      b1 += bytePtr[1];
+      bytePtr[0] = b0;
+      bytePtr[1] = b1;
+      bytePtr += 2;
+    }
+  }
   else if (channels == 3)
   {
     unsigned char b0 = bytePtr[0];
@@ -218,38 +211,71 @@ static void DecodeFPDelta(unsigned char *input, unsigned char *output, int cols,
 }
 #endif
 
-static float expandFloats(unsigned char *dst, int tileWidth, int bytesps)
+/*
+   Maximum of a row, as the running MAX(max, f[i]) from 0 would give it.
+   Four independent maxima let the compiler keep several comparisons in
+   flight; a NaN resets the running value, so such a row takes the
+   one-by-one loop instead.
+ */
+static float floatsMax(const float *f32, int count)
 {
+  float m0 = 0.f, m1 = 0.f, m2 = 0.f, m3 = 0.f;
+  int nan = 0, index = 0;
+  for (; index + 4 <= count; index += 4)
+  {
+    m0 = MAX(m0, f32[index]);
+    m1 = MAX(m1, f32[index + 1]);
+    m2 = MAX(m2, f32[index + 2]);
+    m3 = MAX(m3, f32[index + 3]);
+    nan |= (f32[index] != f32[index]) | (f32[index + 1] != f32[index + 1]) |
+           (f32[index + 2] != f32[index + 2]) |
+           (f32[index + 3] != f32[index + 3]);
+  }
+  for (; index < count; index++)
+  {
+    m0 = MAX(m0, f32[index]);
+    nan |= f32[index] != f32[index];
+  }
+  if (!nan)
+    return MAX(MAX(m0, m1), MAX(m2, m3));
+
   float max = 0.f;
+  for (index = 0; index < count; index++)
+    max = MAX(max, f32[index]);
+  return max;
+}
+
+static float expandFloats(unsigned char *dst, int tileWidth, int bytesps)
+{
+  // Half and 24-bit floats never convert to NaN, so the order is free
   if (bytesps == 2)
   {
     uint16_t *dst16 = (ushort *)dst;
     uint32_t *dst32 = (unsigned int *)dst;
-    float *f32 = (float *)dst;
-    for (int index = tileWidth - 1; index >= 0; --index)
+    int index = tileWidth;
+    // back to front in blocks: a block is read before anything overwrites it
+    for (; index >= 64; index -= 64)
     {
-      dst32[index] = __DNG_HalfToFloat(dst16[index]);
-      max = MAX(max, f32[index]);
+      uint16_t in[64];
+      uint32_t out[64];
+      memcpy(in, dst16 + index - 64, sizeof(in));
+      for (int k = 0; k < 64; k++)
+        out[k] = __DNG_HalfToFloat(in[k]);
+      memcpy(dst32 + index - 64, out, sizeof(out));
     }
+    for (--index; index >= 0; --index)
+      dst32[index] = __DNG_HalfToFloat(dst16[index]);
   }
   else if (bytesps == 3)
   {
     uint8_t *dst8 = ((unsigned char *)dst) + (tileWidth - 1) * 3;
     uint32_t *dst32 = (unsigned int *)dst;
-    float *f32 = (float *)dst;
     for (int index = tileWidth - 1; index >= 0; --index, dst8 -= 3)
-    {
       dst32[index] = __DNG_FP24ToFloat(dst8);
-      max = MAX(max, f32[index]);
-    }
-  }
-  else if (bytesps == 4)
-  {
-    float *f32 = (float *)dst;
-    for (int index = 0; index < tileWidth; index++)
-      max = MAX(max, f32[index]);
   }
-  return max;
+  else if (bytesps != 4)
+    return 0.f;
+  return floatsMax((float *)dst, tileWidth);
 }
 
 struct tile_stripe_data_t
@@ -325,6 +351,120 @@ void tile_stripe_data_t::init(tiff_ifd_t *ifd, const libraw_image_sizes_t& sizes
         }
 }
 
+#ifdef LIBRAW_USE_OPENMP
+// tiles decoded in parallel between two cancellation checks
+#define LIBRAW_DNG_TILES_GROUP 32
+
+/*
+   Decode the leading tiles of a tiled DNG in parallel.  Each thread keeps
+   its own LibRaw object for the bit reader and reads one tile at a time
+   into a memory stream for it; tile() stores the pixels into this object.
+   tile() returns -1 for a tile it leaves to the caller.  Such a tile, or a
+   tile with a decoding error, ends the parallel part: the return value is
+   the number of leading tiles done, and the caller decodes the rest one
+   by one as before.
+ */
+int LibRaw::dng_tiles_parallel(int (LibRaw::*tile)(LibRaw *, unsigned,
+                                                  unsigned, void *),
+                               void *data)
+{
+  LibRaw_abstract_datastream *input = libraw_internal_data.internal_data.input;
+  unpacker_data_t &ud = libraw_internal_data.unpacker_data;
+  int iifd = find_ifd_by_offset(ud.data_offset), t, cancelled = 0;
+  INT64 save = input->tell();
+  tile_stripe_data_t tiles;
+
+  if (iifd < 0 || iifd >= (int)libraw_internal_data.identify_data.tiff_nifds ||
+      ud.tile_length == INT_MAX)
+    return 0;
+  try
+  {
+    input->seek(ud.data_offset, SEEK_SET);
+    tiles.init(&tiff_ifd[iifd], imgdata.sizes, ud, ud.order, input);
+  }
+  catch (...)
+  {
+    tiles.tileCnt = 0;
+  }
+  input->seek(save, SEEK_SET);
+  if (!tiles.tiled || tiles.tileCnt < 2 ||
+      INT64(tiles.maxBytesInTile) >
+          INT64(imgdata.rawparams.max_raw_memory_mb) * INT64(1024 * 1024))
+    return 0;
+  std::vector<char> redo(tiles.tileCnt, 1);
+
+#pragma omp parallel default(shared) private(t)
+  {
+    // getbits(), ljpeg_row() and the libjpeg source keep their state in the
+    // LibRaw object and read its stream, so a worker needs a whole one; it
+    // is made once per thread, not per tile
+    LibRaw *dec = 0;
+    std::vector<uchar> buf;
+    try
+    {
+      dec = new LibRaw(LIBRAW_OPTIONS_NO_DATAERR_CALLBACK);
+      dec->imgdata.idata.dng_version = imgdata.idata.dng_version;
+      dec->libraw_internal_data.unpacker_data.load_flags = ud.load_flags;
+    }
+    catch (...)
+    {
+    }
+    // cancellation is checked by one thread, between groups of tiles
+    for (int first = 0; first < tiles.tileCnt; first += LIBRAW_DNG_TILES_GROUP)
+    {
+#pragma omp single
+      try
+      {
+        checkCancel();
+      }
+      catch (...)
+      {
+        cancelled = 1;
+      }
+      if (cancelled)
+        break;
+#pragma omp for schedule(dynamic)
+      for (t = first; t < MIN(first + LIBRAW_DNG_TILES_GROUP, tiles.tileCnt); t++)
+      {
+        if (!dec)
+          continue;
+        try
+        {
+          int len;
+          buf.resize(tiles.tBytes[t]);
+          if (input->read_at_parallel())
+            len = input->read_at(buf.data(), buf.size(), tiles.tOffsets[t]);
+          else
+          {
+#pragma omp critical
+            len = input->read_at(buf.data(), buf.size(), tiles.tOffsets[t]);
+          }
+          LibRaw_buffer_datastream stream(buf.data(), MAX(len, 0));
+          dec->libraw_internal_data.internal_data.input = &stream;
+          dec->tls->init();
+          dec->libraw_internal_data.unpacker_data.data_error = 0;
+          redo[t] = (this->*tile)(dec, t / tiles.tilesH * ud.tile_length,
+                                  t % tiles.tilesH * ud.tile_width, data) != 1 ||
+                    dec->libraw_internal_data.unpacker_data.data_error;
+        }
+        catch (...)
+        {
+        }
+        dec->libraw_internal_data.internal_data.input = 0;
+      }
+    }
+    delete dec;
+  }
+  // read_at() may move the position of streams without parallel reads
+  input->seek(save, SEEK_SET);
+  if (cancelled)
+    throw LIBRAW_EXCEPTION_CANCELLED_BY_CALLBACK;
+  for (t = 0; t < tiles.tileCnt && !redo[t]; t++)
+    ;
+  return t;
+}
+#endif
+
 #ifdef USE_ZLIB
 void LibRaw::deflate_dng_load_raw()
 {
@@ -377,44 +517,99 @@ void LibRaw::deflate_dng_load_raw()
   if(INT64(tiles.maxBytesInTile) > INT64(imgdata.rawparams.max_raw_memory_mb) * INT64(1024 * 1024) )
     throw LIBRAW_EXCEPTION_TOOBIG;
 
-  std::vector<uchar> cBuffer(tiles.maxBytesInTile);
-  std::vector<uchar> uBuffer(tileBytes + tileRowBytes); // extra row for decoding
+  /*
+     Tiles are inflated in parallel first.  A short or broken tile depends on
+     stale buffer contents (or throws), so it and everything after it are
+     replayed in order with a single buffer, starting one tile earlier.
+     Row maxima are combined in file order at the end.
+   */
+  std::vector<float> rowMax(size_t(tiles.tileCnt) * tiles.tileHeight);
+  int redoFrom = tiles.tileCnt, err = 0;
 
-  for (size_t y = 0, t = 0; y < imgdata.sizes.raw_height; y += tiles.tileHeight)
+  for (int pass = 0; pass < 2; pass++)
+  {
+    if (pass && redoFrom >= tiles.tileCnt)
+      break;
+    int from = pass ? MAX(redoFrom - 1, 0) : 0;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel if (!pass) default(shared)
+#endif
     {
-      for (size_t x = 0; x < imgdata.sizes.raw_width; x += tiles.tileWidth, ++t)
+      std::vector<uchar> cBuffer, uBuffer;
+      int t;
+      try
       {
-        libraw_internal_data.internal_data.input->seek(tiles.tOffsets[t], SEEK_SET);
-        libraw_internal_data.internal_data.input->read(cBuffer.data(), 1, tiles.tBytes[t]);
-        unsigned long dstLen = tileBytes;
-        int err =
-            uncompress(uBuffer.data() + tileRowBytes, &dstLen, cBuffer.data(), (unsigned long)tiles.tBytes[t]);
-        if (err != Z_OK)
+        cBuffer.resize(tiles.maxBytesInTile);
+        uBuffer.resize(tileBytes + tileRowBytes); // extra row for decoding
+      }
+      catch (...)
+      {
+        err = LIBRAW_EXCEPTION_ALLOC;
+      }
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+      for (t = from; t < tiles.tileCnt; t++)
+      {
+        if (err)
+          continue;
+        size_t y = size_t(t / tiles.tilesH) * tiles.tileHeight;
+        size_t x = size_t(t % tiles.tilesH) * tiles.tileWidth;
+        LibRaw_abstract_datastream *input = libraw_internal_data.internal_data.input;
+        int len;
+        if (!pass && input->read_at_parallel())
+          len = input->read_at(cBuffer.data(), tiles.tBytes[t], tiles.tOffsets[t]);
+        else
         {
-          throw LIBRAW_EXCEPTION_DECODE_RAW;
-          return;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp critical
+#endif
+          len = input->read_at(cBuffer.data(), tiles.tBytes[t], tiles.tOffsets[t]);
         }
-        else
+        unsigned long dstLen = tileBytes;
+        int zerr =
+            uncompress(uBuffer.data() + tileRowBytes, &dstLen, cBuffer.data(), (unsigned long)tiles.tBytes[t]);
+        if (zerr != Z_OK || (!pass && (size_t(len) != tiles.tBytes[t] || dstLen != tileBytes)))
         {
-          int bytesps = ifd->bps >> 3;
-          size_t rowsInTile = y + tiles.tileHeight > imgdata.sizes.raw_height ? imgdata.sizes.raw_height - y : tiles.tileHeight;
-          size_t colsInTile = x + tiles.tileWidth > imgdata.sizes.raw_width ? imgdata.sizes.raw_width - x : tiles.tileWidth;
-
-          for (size_t row = 0; row < rowsInTile; ++row) // do not process full tile if not needed
+          if (pass)
+            err = LIBRAW_EXCEPTION_DECODE_RAW;
+          else
           {
-              unsigned char *dst = uBuffer.data() + row * tiles.tileWidth * bytesps * ifd->samples;
-              unsigned char *src = dst + tileRowBytes;
-              DecodeFPDelta(src, dst, tiles.tileWidth / xFactor, ifd->samples * xFactor, bytesps);
-              float lmax = expandFloats(dst, tiles.tileWidth * ifd->samples, bytesps);
-            max = MAX(max, lmax);
-            unsigned char *dst2 = (unsigned char *)&float_raw_image
-                [((y + row) * imgdata.sizes.raw_width + x) * ifd->samples];
-            memmove(dst2, dst, colsInTile * ifd->samples * sizeof(float));
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp critical
+#endif
+            redoFrom = MIN(redoFrom, t);
           }
+          continue;
+        }
+        int bytesps = ifd->bps >> 3;
+        size_t rowsInTile = y + tiles.tileHeight > imgdata.sizes.raw_height ? imgdata.sizes.raw_height - y : tiles.tileHeight;
+        size_t colsInTile = x + tiles.tileWidth > imgdata.sizes.raw_width ? imgdata.sizes.raw_width - x : tiles.tileWidth;
+
+        for (size_t row = 0; row < rowsInTile; ++row) // do not process full tile if not needed
+        {
+          unsigned char *dst = uBuffer.data() + row * tiles.tileWidth * bytesps * ifd->samples;
+          unsigned char *src = dst + tileRowBytes;
+          DecodeFPDelta(src, dst, tiles.tileWidth / xFactor, ifd->samples * xFactor, bytesps);
+          rowMax[size_t(t) * tiles.tileHeight + row] =
+              expandFloats(dst, tiles.tileWidth * ifd->samples, bytesps);
+          unsigned char *dst2 = (unsigned char *)&float_raw_image
+              [((y + row) * imgdata.sizes.raw_width + x) * ifd->samples];
+          memmove(dst2, dst, colsInTile * ifd->samples * sizeof(float));
         }
       }
     }
-  
+    if (err)
+    {
+      free(float_raw_image);
+      throw (LibRaw_exceptions)err;
+    }
+  }
+  for (size_t y = 0, t = 0; y < imgdata.sizes.raw_height; y += tiles.tileHeight)
+    for (size_t x = 0; x < imgdata.sizes.raw_width; x += tiles.tileWidth, ++t)
+      for (size_t row = 0; row < tiles.tileHeight && y + row < imgdata.sizes.raw_height; ++row)
+        max = MAX(max, rowMax[t * tiles.tileHeight + row]);
+
   imgdata.color.fmaximum = max;
 
   // Set fields according to data format
@@ -515,9 +710,12 @@ void LibRaw::convertFloatToInt(float dmin /* =4096.f */,
   else
     imgdata.rawdata.color.fnorm = imgdata.color.fnorm = 0.f;
 
-  for (size_t i = 0; i < imgdata.sizes.raw_height * imgdata.sizes.raw_width *
-                             libraw_internal_data.unpacker_data.tiff_samples;
-       ++i)
+  INT64 total = INT64(imgdata.sizes.raw_height) * imgdata.sizes.raw_width *
+                libraw_internal_data.unpacker_data.tiff_samples;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared)
+#endif
+  for (INT64 i = 0; i < total; ++i)
   {
     float val = MAX(data[i], 0.f);
     raw_alloc[i] = (ushort)(val * multip);
@@ -583,6 +781,15 @@ void libraw_swap32(uchar *data, int len)
     }
 }
 
+void LibRaw::fp_dng_swap_row(uchar *data, int len, int bytesps, bool difford)
+{
+    if (bytesps == 2 && difford)
+        libraw_swab(data, len);
+    else if (bytesps == 3 && (libraw_internal_data.unpacker_data.order == 0x4949)) // II-16bit
+        libraw_swap24(data, len);
+    if (bytesps == 4 && difford)
+        libraw_swap32(data, len);
+}
 
 void LibRaw::uncompressed_fp_dng_load_raw()
 {
@@ -623,9 +830,104 @@ void LibRaw::uncompressed_fp_dng_load_raw()
     bool difford = (libraw_internal_data.unpacker_data.order == 0x4949) == (ntohs(0x1234) == 0x1234);
     float max = 0.f;
 
+    /*
+       Bands of rows are read with read_at() and converted in parallel, row
+       maxima are combined in file order. With a short read the row by row
+       loop below keeps stale buffer contents, so such a band is not stored
+       (or zeroed again if read in place) and all tiles are read once more
+       by that loop.
+     */
+    int fullrowbytes = tiles.tileWidth * bytesps * ifd->samples;
+    unsigned bandsInTile = (tiles.tileHeight + LIBRAW_RAW_BAND - 1) / LIBRAW_RAW_BAND;
+    bool inplace = tiles.tileWidth == imgdata.sizes.raw_width; // tile rows are image rows
+    std::vector<float> rowMax(size_t(tiles.tileCnt) * tiles.tileHeight);
+    int shortRead = 0, err = 0;
+
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+    {
+        std::vector<uchar> band, lastbuf;
+        int u;
+        try
+        {
+            if (!inplace)
+                band.resize(size_t(MIN(tiles.tileHeight, LIBRAW_RAW_BAND)) * fullrowbytes);
+            lastbuf.resize(tiles.tileWidth * sizeof(float) * ifd->samples);
+        }
+        catch (...)
+        {
+            err = LIBRAW_EXCEPTION_ALLOC;
+        }
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+        for (u = 0; u < tiles.tileCnt * int(bandsInTile); u++)
+        {
+            int t = u / bandsInTile;
+            size_t y = size_t(t / tiles.tilesH) * tiles.tileHeight;
+            size_t x = size_t(t % tiles.tilesH) * tiles.tileWidth;
+            size_t row0 = size_t(u % bandsInTile) * LIBRAW_RAW_BAND;
+            size_t rowsInTile = y + tiles.tileHeight > imgdata.sizes.raw_height ? imgdata.sizes.raw_height - y : tiles.tileHeight;
+            size_t colsInTile = x + tiles.tileWidth > imgdata.sizes.raw_width ? imgdata.sizes.raw_width - x : tiles.tileWidth;
+            if (err || shortRead || row0 >= rowsInTile)
+                continue;
+            size_t rows = MIN(rowsInTile - row0, size_t(LIBRAW_RAW_BAND));
+            size_t outrowbytes = colsInTile * sizeof(float) * ifd->samples;
+            size_t bytes = rows * fullrowbytes;
+            float *out = &float_raw_image[((y + row0) * imgdata.sizes.raw_width + x) * ifd->samples];
+
+            // in place, the packed rows go to the end of the band so that each
+            // expanded row only overwrites rows already done
+            uchar *src = inplace ? (uchar *)out + rows * outrowbytes - bytes : band.data();
+            LibRaw_abstract_datastream *input = libraw_internal_data.internal_data.input;
+            INT64 offset = INT64(tiles.tOffsets[t]) + INT64(row0) * fullrowbytes;
+            int len;
+            if (input->read_at_parallel())
+                len = input->read_at(src, bytes, offset);
+            else
+            {
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp critical
+#endif
+                len = input->read_at(src, bytes, offset);
+            }
+            if (size_t(len) != bytes)
+            {
+                if (inplace)
+                    memset(out, 0, rows * outrowbytes);
+                shortRead = 1;
+                continue;
+            }
+
+            for (size_t row = 0; row < rows; ++row, src += fullrowbytes)
+            {
+                unsigned char *dst = size_t(fullrowbytes) > colsInTile * bytesps * ifd->samples
+                                                                  ? lastbuf.data() // last tile in row, use buffer
+                                                                  : (unsigned char *)&out[row * imgdata.sizes.raw_width * ifd->samples];
+                memmove(dst, src, fullrowbytes);
+                fp_dng_swap_row(dst, fullrowbytes, bytesps, difford);
+                rowMax[size_t(t) * tiles.tileHeight + row0 + row] =
+                        expandFloats(dst, tiles.tileWidth * ifd->samples, bytesps);
+                if (dst == lastbuf.data())
+                    memmove(&out[row * imgdata.sizes.raw_width * ifd->samples], dst, outrowbytes);
+            }
+        }
+    }
+    if (err)
+    {
+        free(float_raw_image);
+        throw (LibRaw_exceptions)err;
+    }
+    if (!shortRead)
+        for (size_t y = 0, t = 0; y < imgdata.sizes.raw_height; y += tiles.tileHeight)
+            for (size_t x = 0; x < imgdata.sizes.raw_width; x += tiles.tileWidth, ++t)
+                for (size_t row = 0; row < tiles.tileHeight && y + row < imgdata.sizes.raw_height; ++row)
+                    max = MAX(max, rowMax[t * tiles.tileHeight + row]);
+
     std::vector<uchar> rowbuf(tiles.tileWidth *sizeof(float) * ifd->samples); // line buffer for last tile in tile row
 
-    for (size_t y = 0, t = 0; y < imgdata.sizes.raw_height; y += tiles.tileHeight)
+    for (size_t y = 0, t = 0; shortRead && y < imgdata.sizes.raw_height; y += tiles.tileHeight)
     {
         for (unsigned x = 0; x < imgdata.sizes.raw_width  && t < (unsigned)tiles.tileCnt; x += tiles.tileWidth, ++t)
         {
@@ -634,7 +936,6 @@ void LibRaw::uncompressed_fp_dng_load_raw()
             size_t colsInTile = x + tiles.tileWidth > imgdata.sizes.raw_width ? imgdata.sizes.raw_width - x : tiles.tileWidth;
 
             size_t inrowbytes = colsInTile * bytesps * ifd->samples;
-            int fullrowbytes = tiles.tileWidth *bytesps * ifd->samples;
             size_t outrowbytes = colsInTile * sizeof(float) * ifd->samples;
 
             for (size_t row = 0; row < rowsInTile; ++row) // do not process full tile if not needed
@@ -643,12 +944,7 @@ void LibRaw::uncompressed_fp_dng_load_raw()
                     (unsigned char *)&float_raw_image
                     [((y + row) * imgdata.sizes.raw_width + x) * ifd->samples];
                 libraw_internal_data.internal_data.input->read(dst, 1, fullrowbytes);
-                if (bytesps == 2 && difford)
-                    libraw_swab(dst, fullrowbytes);
-                else if (bytesps == 3 && (libraw_internal_data.unpacker_data.order == 0x4949)) // II-16bit
-                    libraw_swap24(dst, fullrowbytes);
-                if (bytesps == 4 && difford)
-                    libraw_swap32(dst, fullrowbytes);
+                fp_dng_swap_row(dst, fullrowbytes, bytesps, difford);
 
                 float lmax = expandFloats(
                     dst,
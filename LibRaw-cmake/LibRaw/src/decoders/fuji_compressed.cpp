@@ -229,33 +229,39 @@ static inline void fuji_fill_buffer(fuji_compressed_block *info)
 {
   if (info->cur_pos >= info->cur_buf_size)
   {
+    unsigned to_read = _min(info->max_read_size, XTRANS_BUF_SIZE);
     info->cur_pos = 0;
     info->cur_buf_offset += info->cur_buf_size;
+    // positional reads let strips fetch their data without a shared lock
+    if (info->input->read_at_parallel())
+      info->cur_buf_size = info->input->read_at(info->cur_buf, to_read, info->cur_buf_offset);
+    else
+    {
 #ifdef LIBRAW_USE_OPENMP
 #pragma omp critical
 #endif
-    {
+      {
 #ifndef LIBRAW_USE_OPENMP
-      info->input->lock();
+        info->input->lock();
 #endif
-      info->input->seek(info->cur_buf_offset, SEEK_SET);
-      info->cur_buf_size = info->input->read(info->cur_buf, 1, _min(info->max_read_size, XTRANS_BUF_SIZE));
+        info->cur_buf_size = info->input->read_at(info->cur_buf, to_read, info->cur_buf_offset);
 #ifndef LIBRAW_USE_OPENMP
-      info->input->unlock();
+        info->input->unlock();
 #endif
-      if (info->cur_buf_size < 1) // nothing read
+      }
+    }
+    if (info->cur_buf_size < 1) // nothing read
+    {
+      if (info->fillbytes > 0)
       {
-        if (info->fillbytes > 0)
-        {
-          int ls = _max(1, _min(info->fillbytes, XTRANS_BUF_SIZE));
-          memset(info->cur_buf, 0, ls);
-          info->fillbytes -= ls;
-        }
-        else
-          throw LIBRAW_EXCEPTION_IO_EOF;
+        int ls = _max(1, _min(info->fillbytes, XTRANS_BUF_SIZE));
+        memset(info->cur_buf, 0, ls);
+        info->fillbytes -= ls;
       }
-      info->max_read_size -= info->cur_buf_size;
+      else
+        throw LIBRAW_EXCEPTION_IO_EOF;
     }
+    info->max_read_size -= info->cur_buf_size;
   }
 }
 
@@ -315,18 +321,20 @@ void LibRaw::init_fuji_block(fuji_compressed_block *info, const fuji_compressed_
   }
 }
 
+/*
+   X-Trans: pixel 6k+j of a row comes from line (row, j) at 4k + xt_offset[j],
+   so each row is filled from six fixed sources without per-pixel lookups.
+ */
 void LibRaw::copy_line_to_xtrans(fuji_compressed_block *info, int cur_line, int cur_block, int cur_block_width)
 {
+  static const int xt_offset[6] = {0, 1, 1, 2, 3, 3};
   ushort *lineBufB[3];
   ushort *lineBufG[6];
   ushort *lineBufR[3];
-  unsigned pixel_count;
-  ushort *line_buf;
-  int index;
+  const ushort *src[6];
 
   int offset = libraw_internal_data.unpacker_data.fuji_block_width * cur_block + 6 * imgdata.sizes.raw_width * cur_line;
   ushort *raw_block_data = imgdata.rawdata.raw_image + offset;
-  int row_count = 0;
 
   for (int i = 0; i < 3; i++)
   {
@@ -336,42 +344,42 @@ void LibRaw::copy_line_to_xtrans(fuji_compressed_block *info, int cur_line, int
   for (int i = 0; i < 6; i++)
     lineBufG[i] = info->linebuf[_G2 + i] + 1;
 
-  while (row_count < 6)
+  for (int row_count = 0; row_count < 6; row_count++, raw_block_data += imgdata.sizes.raw_width)
   {
-    pixel_count = 0;
-    while (pixel_count < (unsigned)cur_block_width)
+    for (int j = 0; j < 6; j++)
     {
-      switch (imgdata.idata.xtrans_abs[row_count][(pixel_count % 6)])
+      switch (imgdata.idata.xtrans_abs[row_count][j])
       {
       case 0: // red
-        line_buf = lineBufR[row_count >> 1];
+        src[j] = lineBufR[row_count >> 1] + xt_offset[j];
         break;
       case 1:  // green
       default: // to make static analyzer happy
-        line_buf = lineBufG[row_count];
+        src[j] = lineBufG[row_count] + xt_offset[j];
         break;
       case 2: // blue
-        line_buf = lineBufB[row_count >> 1];
+        src[j] = lineBufB[row_count >> 1] + xt_offset[j];
         break;
       }
-
-      index = (((pixel_count * 2 / 3) & 0x7FFFFFFE) | ((pixel_count % 3) & 1)) + ((pixel_count % 3) >> 1);
-      raw_block_data[pixel_count] = line_buf[index];
-
-      ++pixel_count;
     }
-    ++row_count;
-    raw_block_data += imgdata.sizes.raw_width;
+    int pixel_count = 0, k = 0;
+    for (; pixel_count + 6 <= cur_block_width; pixel_count += 6, k += 4)
+      for (int j = 0; j < 6; j++)
+        raw_block_data[pixel_count + j] = src[j][k];
+    for (int j = 0; pixel_count < cur_block_width; pixel_count++, j++)
+      raw_block_data[pixel_count] = src[j][k];
   }
 }
 
+/*
+   Bayer: even and odd pixels of a row come from two lines, interleaved.
+ */
 void LibRaw::copy_line_to_bayer(fuji_compressed_block *info, int cur_line, int cur_block, int cur_block_width)
 {
   ushort *lineBufB[3];
   ushort *lineBufG[6];
   ushort *lineBufR[3];
-  unsigned pixel_count;
-  ushort *line_buf;
+  const ushort *src[2];
 
   int fuji_bayer[2][2];
   for (int r = 0; r < 2; r++)
@@ -380,7 +388,6 @@ void LibRaw::copy_line_to_bayer(fuji_compressed_block *info, int cur_line, int c
 
   int offset = libraw_internal_data.unpacker_data.fuji_block_width * cur_block + 6 * imgdata.sizes.raw_width * cur_line;
   ushort *raw_block_data = imgdata.rawdata.raw_image + offset;
-  int row_count = 0;
 
   for (int i = 0; i < 3; i++)
   {
@@ -390,31 +397,33 @@ void LibRaw::copy_line_to_bayer(fuji_compressed_block *info, int cur_line, int c
   for (int i = 0; i < 6; i++)
     lineBufG[i] = info->linebuf[_G2 + i] + 1;
 
-  while (row_count < 6)
+  for (int row_count = 0; row_count < 6; row_count++, raw_block_data += imgdata.sizes.raw_width)
   {
-    pixel_count = 0;
-    while (pixel_count < (unsigned)cur_block_width)
+    for (int j = 0; j < 2; j++)
     {
-      switch (fuji_bayer[row_count & 1][pixel_count & 1])
+      switch (fuji_bayer[row_count & 1][j])
       {
       case 0: // red
-        line_buf = lineBufR[row_count >> 1];
+        src[j] = lineBufR[row_count >> 1];
         break;
       case 1:  // green
       case 3:  // second green
       default: // to make static analyzer happy
-        line_buf = lineBufG[row_count];
+        src[j] = lineBufG[row_count];
         break;
       case 2: // blue
-        line_buf = lineBufB[row_count >> 1];
+        src[j] = lineBufB[row_count >> 1];
         break;
       }
-
-      raw_block_data[pixel_count] = line_buf[pixel_count >> 1];
-      ++pixel_count;
     }
-    ++row_count;
-    raw_block_data += imgdata.sizes.raw_width;
+    int pixel_count = 0;
+    for (; pixel_count + 2 <= cur_block_width; pixel_count += 2)
+    {
+      raw_block_data[pixel_count] = src[0][pixel_count >> 1];
+      raw_block_data[pixel_count + 1] = src[1][pixel_count >> 1];
+    }
+    if (pixel_count < cur_block_width)
+      raw_block_data[pixel_count] = src[0][pixel_count >> 1];
   }
 }
 
@@ -422,21 +431,33 @@ void LibRaw::copy_line_to_bayer(fuji_compressed_block *info, int cur_line, int c
 
 static inline void fuji_zerobits(fuji_compressed_block *info, int *count)
 {
-  uchar zero = 0;
   *count = 0;
-  while (zero == 0)
+  // count whole runs of zero bits in the current byte at once
+  for (;;)
   {
-    zero = (info->cur_buf[info->cur_pos] >> (7 - info->cur_bit)) & 1;
-    info->cur_bit++;
-    info->cur_bit &= 7;
-    if (!info->cur_bit)
+    uchar bits = info->cur_buf[info->cur_pos] << info->cur_bit;
+    if (bits)
     {
-      ++info->cur_pos;
-      fuji_fill_buffer(info);
+      int zeros = 0;
+      while (!(bits & 0x80))
+      {
+        bits <<= 1;
+        ++zeros;
+      }
+      *count += zeros;
+      info->cur_bit += zeros + 1;
+      if (info->cur_bit == 8)
+      {
+        info->cur_bit = 0;
+        ++info->cur_pos;
+        fuji_fill_buffer(info);
+      }
+      return;
     }
-    if (zero)
-      break;
-    ++*count;
+    *count += 8 - info->cur_bit;
+    info->cur_bit = 0;
+    ++info->cur_pos;
+    fuji_fill_buffer(info);
   }
 }
 
@@ -447,6 +468,17 @@ static inline void fuji_read_code(fuji_compressed_block *info, int *data, int bi
   *data = 0;
   if (!bits_to_read)
     return;
+  if (bits_to_read <= 24 && info->cur_pos + 3 < info->cur_buf_size)
+  {
+    // the code lies within the next four buffered bytes: take it in one go
+    const uchar *p = info->cur_buf + info->cur_pos;
+    unsigned window = (unsigned)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+    int bit = info->cur_bit + bits_to_read;
+    *data = (window << info->cur_bit) >> (32 - bits_to_read);
+    info->cur_pos += bit >> 3;
+    info->cur_bit = bit & 7;
+    return;
+  }
   if (bits_to_read >= bits_left_in_byte)
   {
     do
@@ -1151,13 +1183,30 @@ void LibRaw::fuji_decode_loop(fuji_compressed_params *common_info, int count, IN
   int cur_block;
   const int lineStep = (libraw_internal_data.unpacker_data.fuji_total_lines + 0xF) & ~0xF;
 #ifdef LIBRAW_USE_OPENMP
+  int err = 0;
 #pragma omp parallel for private(cur_block)
 #endif
   for (cur_block = 0; cur_block < count; cur_block++)
   {
-    fuji_decode_strip(common_info, cur_block, raw_block_offsets[cur_block], block_sizes[cur_block],
-                      q_bases ? q_bases + cur_block * lineStep : 0);
+#ifdef LIBRAW_USE_OPENMP
+    // exceptions must not leave the parallel region
+    try
+    {
+#endif
+      fuji_decode_strip(common_info, cur_block, raw_block_offsets[cur_block], block_sizes[cur_block],
+                        q_bases ? q_bases + cur_block * lineStep : 0);
+#ifdef LIBRAW_USE_OPENMP
+    }
+    catch (LibRaw_exceptions e)
+    {
+      err = e;
+    }
+#endif
   }
+#ifdef LIBRAW_USE_OPENMP
+  if (err)
+    throw (LibRaw_exceptions)err;
+#endif
 }
 
 void LibRaw::parse_fuji_compressed_header()
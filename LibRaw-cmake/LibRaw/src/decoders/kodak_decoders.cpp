@@ -18,7 +18,7 @@
 
 #include "../../internal/dcraw_defs.h"
 
-#define radc_token(tree) ((signed char)getbithuff(8, huff + (tree) * 256))
+#define radc_token(tree) ((signed char)getbithuff_fast(8, huff + (tree) * 256))
 
 #define FORYX                                                                  \
   for (y = 1; y < 3; y++)                                                      \
@@ -315,9 +315,9 @@ void LibRaw::kodak_262_load_raw()
       {0, 3, 1, 1, 1, 1, 1, 2, 0, 0, 0, 0, 0,
        0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9}};
   ushort *huff[2];
-  int *strip, ns, c, row, col, chess, pi = 0, pi1, pi2, pred, val;
+  int *fast[2], *strip, ns, c, row, col, chess, pi = 0, pi1, pi2, pred, val;
 
-  FORC(2) huff[c] = make_decoder(kodak_tree[c]);
+  FORC(2) fast[c] = decoder_lookahead(huff[c] = make_decoder(kodak_tree[c]));
   ns = (raw_height + 63) >> 5;
   std::vector<uchar> pixel(raw_width * 32 + ns * 4);
   strip = (int *)(pixel.data() + raw_width * 32);
@@ -348,7 +348,7 @@ void LibRaw::kodak_262_load_raw()
         if (pi1 < 0 && col > 1)
           pi1 = pi2 = pi - 2;
         pred = (pi1 < 0) ? 0 : (pixel[pi1] + pixel[pi2]) >> 1;
-        pixel[pi] = val = pred + ljpeg_diff(huff[chess]);
+        pixel[pi] = val = pred + ljpeg_diff_fast(huff[chess], fast[chess]);
         if (val >> 8)
           derror();
         val = curve[pixel[pi++]];
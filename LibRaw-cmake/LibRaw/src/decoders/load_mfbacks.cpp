@@ -137,7 +137,7 @@ void LibRaw::phase_one_fix_pixel_grad(unsigned row, unsigned col)
 void LibRaw::phase_one_flat_field(int is_float, int nc)
 {
   ushort head[8];
-  unsigned wide, high, y, x, c, rend, cend, row, col;
+  unsigned wide, high, y, x, c, rend, cend, row, col, nrows;
   float *mrow, num, mult[4];
 
   read_shorts(head, 8);
@@ -161,16 +161,32 @@ void LibRaw::phase_one_flat_field(int is_float, int nc)
     if (y == 0)
       continue;
     rend = head[1] + y * head[5];
-    for (row = rend - head[5];
+    for (nrows = 0, row = rend - head[5];
          row < raw_height && row < rend && row < unsigned(head[1] + head[3] - head[5]);
          row++)
+      nrows++;
+    /*
+       Column cells are independent: each one steps its own copy of the two
+       mrow[] columns it interpolates between, row by row, with the same
+       additions as the shared mrow[] update below.
+     */
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(dynamic) default(shared) private(x, c, row, col, cend, mult)
+#endif
+    for (x = 1; x < wide; x++)
     {
-      for (x = 1; x < wide; x++)
+      float lo[4], hi[4];
+      for (c = 0; c < (unsigned)nc; c++)
+      {
+        lo[c] = mrow[c * wide + x - 1];
+        hi[c] = mrow[c * wide + x];
+      }
+      for (row = rend - head[5]; row < rend - head[5] + nrows; row++)
       {
         for (c = 0; c < (unsigned)nc; c += 2)
         {
-          mult[c] = mrow[c * wide + x - 1];
-          mult[c + 1] = (mrow[c * wide + x] - mult[c]) / head[4];
+          mult[c] = lo[c];
+          mult[c + 1] = (hi[c] - mult[c]) / head[4];
         }
         cend = head[0] + x * head[4];
         for (col = cend - head[4];
@@ -186,15 +202,36 @@ void LibRaw::phase_one_flat_field(int is_float, int nc)
           for (c = 0; c < (unsigned)nc; c += 2)
             mult[c] += mult[c + 1];
         }
+        for (c = 0; c < (unsigned)nc; c += 2)
+        {
+          lo[c] += lo[c + 1];
+          hi[c] += hi[c + 1];
+        }
       }
+    }
+    for (row = 0; row < nrows; row++)
       for (x = 0; x < wide; x++)
         for (c = 0; c < (unsigned)nc; c += 2)
           mrow[c * wide + x] += mrow[(c + 1) * wide + x];
-    }
   }
   free(mrow);
 }
 
+/* Maps RAW() rows [row0, row1), columns [col0, col1) through curve[] */
+void LibRaw::phase_one_apply_curve(unsigned row0, unsigned row1, unsigned col0,
+                                   unsigned col1)
+{
+  unsigned row, col;
+
+  checkCancel();
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(row, col)
+#endif
+  for (row = row0; row < row1; row++)
+    for (col = col0; col < col1; col++)
+      RAW(row, col) = curve[RAW(row, col)];
+}
+
 int LibRaw::phase_one_correct()
 {
   unsigned entries, tag, data, save, col, row, type;
@@ -318,12 +355,8 @@ int LibRaw::phase_one_correct()
           curve[i] = LIM(num + i, 0, 65535);
         }
       apply: /* apply to whole image */
-        for (row = 0; row < raw_height; row++)
-        {
-          checkCancel();
-          for (col = (tag & 1) * ph1.split_col; col < raw_width; col++)
-            RAW(row, col) = curve[RAW(row, col)];
-        }
+        phase_one_apply_curve(0, raw_height, (tag & 1) * ph1.split_col,
+                              raw_width);
       }
       else if (tag == 0x0401)
       { /* All-color flat fields - luma calibration*/
@@ -386,14 +419,10 @@ int LibRaw::phase_one_correct()
             cf[18] = cx[18] = 65535;
             cubic_spline(cx, cf, 19);
 
-            for (row = (qr ? ph1.split_row : 0);
-                 row < unsigned(qr ? raw_height : ph1.split_row); row++)
-            {
-              checkCancel();
-              for (col = (qc ? ph1.split_col : 0);
-                   col < unsigned(qc ? raw_width : ph1.split_col); col++)
-                RAW(row, col) = curve[RAW(row, col)];
-            }
+            phase_one_apply_curve(qr ? ph1.split_row : 0,
+                                  qr ? raw_height : ph1.split_row,
+                                  qc ? ph1.split_col : 0,
+                                  qc ? raw_width : ph1.split_col);
           }
         }
         qlin_applied = 1;
@@ -420,9 +449,12 @@ int LibRaw::phase_one_correct()
         get4();
         get4();
         qmult[1][1] = 1.0 + getreal(LIBRAW_EXIFTAG_TYPE_FLOAT);
+        checkCancel();
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(row, col, i)
+#endif
         for (row = 0; row < raw_height; row++)
         {
-          checkCancel();
           for (col = 0; col < raw_width; col++)
           {
             i = qmult[row >= (unsigned)ph1.split_row][col >= (unsigned)ph1.split_col] *
@@ -455,14 +487,10 @@ int LibRaw::phase_one_correct()
             cx[0] = cf[0] = 0;
             cx[8] = cf[8] = 65535;
             cubic_spline(cx, cf, 9);
-            for (row = (qr ? ph1.split_row : 0);
-                 row < unsigned(qr ? raw_height : ph1.split_row); row++)
-            {
-              checkCancel();
-              for (col = (qc ? ph1.split_col : 0);
-                   col < unsigned(qc ? raw_width : ph1.split_col); col++)
-                RAW(row, col) = curve[RAW(row, col)];
-            }
+            phase_one_apply_curve(qr ? ph1.split_row : 0,
+                                  qr ? raw_height : ph1.split_row,
+                                  qc ? ph1.split_col : 0,
+                                  qc ? raw_width : ph1.split_col);
           }
         }
         qmult_applied = 1;
@@ -477,6 +505,10 @@ int LibRaw::phase_one_correct()
       for (i = 0; i < (int)badCols.size(); ++i)
       {
         bool nextIsolated = i == ((int)(badCols.size()-1)) || badCols[i+1]>badCols[i]+4;
+        // a column fix reads other columns only, so its rows are independent
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(row)
+#endif
         for (row = 0; row < raw_height; ++row)
           if (prevIsolated && nextIsolated)
             phase_one_fix_pixel_grad(row,badCols[i]);
@@ -501,9 +533,12 @@ int LibRaw::phase_one_correct()
       for (i = 0; i < 2; i++)
         for (j = 0; j < head[i + 1] * head[i + 3]; j++)
           xval[i][j] = get2();
+      checkCancel();
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(row, col, cfrac, cip, num, i, j, k, frac, mult)
+#endif
       for (row = 0; row < raw_height; row++)
       {
-        checkCancel();
         for (col = 0; col < raw_width; col++)
         {
           cfrac = (float)col * head[3] / raw_width;
@@ -564,6 +599,10 @@ void LibRaw::phase_one_load_raw()
   fseek(ifp, data_offset, SEEK_SET);
   read_shorts(raw_image, raw_width * raw_height);
   if (ph1.format)
+  {
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(a, b, i)
+#endif
     for (i = 0; i < raw_width * raw_height; i += 2)
     {
       a = raw_image[i + 0] ^ akey;
@@ -571,6 +610,7 @@ void LibRaw::phase_one_load_raw()
       raw_image[i + 0] = (a & t_mask) | (b & ~t_mask);
       raw_image[i + 1] = (b & t_mask) | (a & ~t_mask);
     }
+  }
 }
 
 unsigned LibRaw::ph1_bithuff(int nbits, ushort *huff)
@@ -607,6 +647,72 @@ unsigned LibRaw::ph1_bithuff(int nbits, ushort *huff)
 #endif
 }
 
+/* In-memory counterpart of ph1_bits() for rows decoded in parallel */
+struct ph1_mem_bits_t
+{
+  UINT64 bitbuf;
+  int vbits;
+  uchar *src;
+  short byte_order;
+  ph1_mem_bits_t(uchar *_src, short _order)
+      : bitbuf(0), vbits(0), src(_src), byte_order(_order)
+  {
+  }
+  unsigned get(int nbits)
+  {
+    if (vbits < nbits)
+    {
+      bitbuf = bitbuf << 32 | libraw_sget4_static(byte_order, src);
+      src += 4;
+      vbits += 32;
+    }
+    unsigned c = bitbuf << (64 - vbits) >> (64 - nbits);
+    vbits -= nbits;
+    return c;
+  }
+};
+
+/*
+   Decodes one phase_one_load_raw_c() row from memory into pixel[] and leaves
+   the last code lengths in len[]. Returns 0 when the row has to go through
+   the serial decoder instead: it starts with code lengths carried over from
+   the previous row, or a predictor leaves the 16-bit range (derror()).
+ */
+int LibRaw::phase_one_c_row(uchar *src, ushort *pixel, int len[2])
+{
+  static const int length[] = {8, 7, 6, 9, 11, 10, 5, 12, 14, 13};
+  ph1_mem_bits_t bits(src, order);
+  int pred[2] = {0, 0}, col, i, j;
+
+  for (col = 0; col < raw_width; col++)
+  {
+    if (col >= (raw_width & -8))
+      len[0] = len[1] = 14;
+    else if ((col & 7) == 0)
+      for (i = 0; i < 2; i++)
+      {
+        for (j = 0; j < 5 && !bits.get(1); j++)
+          ;
+        if (j--)
+          len[i] = length[j * 2 + bits.get(1)];
+        else if (!col)
+          return 0;
+      }
+    if ((i = len[col & 1]) == 14)
+      pixel[col] = pred[col & 1] = bits.get(16);
+    else
+      pixel[col] = pred[col & 1] += bits.get(i) + 1 - (1 << (i - 1));
+    if (pred[col & 1] >> 16)
+      return 0;
+    if (ph1.format == 5 && pixel[col] < 256)
+      pixel[col] = curve[pixel[col]];
+  }
+  if (ph1.format != 8)
+    for (col = 0; col < raw_width; col++)
+      pixel[col] <<= 2;
+  return 1;
+}
+
 void LibRaw::phase_one_load_raw_c()
 {
   static const int length[] = {8, 7, 6, 9, 11, 10, 5, 12, 14, 13};
@@ -645,11 +751,65 @@ void LibRaw::phase_one_load_raw_c()
 
   for (i = 0; i < 256; i++)
     curve[i] = i * i / 3.969 + 0.5;
+
+  /*
+     Every row starts at its own offset[], so bands of rows are decoded in
+     parallel from memory first. Rows this cannot reproduce exactly (see
+     phase_one_c_row(), or data running past the end of file) are left to
+     the serial loop below, which also keeps derror() calls in row order.
+   */
+  const INT64 rowbytes =
+      (INT64(raw_width) * 16 + (raw_width + 7) / 8 * 12) / 32 * 4 + 8;
+  const INT64 fsize = ifp->size();
+  std::vector<uchar> rowdata;
+  std::vector<ushort> band;
+  int bandlen[LIBRAW_RAW_BAND][2];
+  char ready[LIBRAW_RAW_BAND];
+
   try
   {
+    rowdata.resize(rowbytes * LIBRAW_RAW_BAND);
+    band.resize(size_t(raw_width) * LIBRAW_RAW_BAND);
     for (row = 0; row < raw_height; row++)
     {
       checkCancel();
+      if (!(row % LIBRAW_RAW_BAND))
+      {
+        int rows = MIN(LIBRAW_RAW_BAND, raw_height - row), r;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(dynamic) default(shared) private(r)
+#endif
+        for (r = 0; r < rows; r++)
+        {
+          INT64 start = INT64(data_offset) + offset[row + r];
+          uchar *src = &rowdata[rowbytes * r];
+          int got = 0;
+          if (start >= 0 && start + rowbytes <= fsize)
+          {
+#ifdef LIBRAW_USE_OPENMP
+            if (ifp->read_at_parallel())
+              got = ifp->read_at(src, rowbytes, start);
+            else
+            {
+#pragma omp critical
+              got = ifp->read_at(src, rowbytes, start);
+            }
+#else
+            got = ifp->read_at(src, rowbytes, start);
+#endif
+          }
+          ready[r] = got == rowbytes &&
+                     phase_one_c_row(src, &band[size_t(raw_width) * r], bandlen[r]);
+        }
+      }
+      if (ready[row % LIBRAW_RAW_BAND])
+      {
+        memmove(&RAW(row, 0), &band[size_t(raw_width) * (row % LIBRAW_RAW_BAND)],
+                raw_width * 2);
+        len[0] = bandlen[row % LIBRAW_RAW_BAND][0];
+        len[1] = bandlen[row % LIBRAW_RAW_BAND][1];
+        continue;
+      }
       fseek(ifp, data_offset + offset[row], SEEK_SET);
       ph1_bits(-1);
       pred[0] = pred[1] = 0;
@@ -60,6 +60,14 @@ int LibRaw::unpack(void)
     libraw_decoder_info_t decoder_info;
     get_decoder_info(&decoder_info);
 
+    libraw_internal_data.unpacker_data.rawband_done = 0;
+    libraw_internal_data.unpacker_data.rawband_ring =
+        (callbacks.rawband_cb &&
+         (imgdata.rawparams.options & LIBRAW_RAWOPTIONS_RAWBAND_RING) &&
+         (decoder_info.decoder_flags & LIBRAW_DECODER_RAWBANDRING))
+            ? rawband_height()
+            : 0;
+
     int save_iwidth = S.iwidth, save_iheight = S.iheight,
         save_shrink = IO.shrink;
 
@@ -352,13 +360,17 @@ int LibRaw::unpack(void)
                P1.colors ==
                    1) // Bayer image or single color -> decode to raw_image
       {
-        if (INT64(rwidth) * INT64(rheight + 8) *
+        // rawband ring mode: decoder reuses single band of rows
+        int arows = libraw_internal_data.unpacker_data.rawband_ring
+                        ? libraw_internal_data.unpacker_data.rawband_ring
+                        : rheight;
+        if (INT64(rwidth) * INT64(arows + 8) *
                 INT64(sizeof(imgdata.rawdata.raw_image[0])) 
 			+ INT64(libraw_internal_data.unpacker_data.meta_length) >
             INT64(imgdata.rawparams.max_raw_memory_mb) * INT64(1024 * 1024))
           throw LIBRAW_EXCEPTION_TOOBIG;
         imgdata.rawdata.raw_alloc = malloc(
-            rwidth * (rheight + 8) * sizeof(imgdata.rawdata.raw_image[0]));
+            rwidth * (arows + 8) * sizeof(imgdata.rawdata.raw_image[0]));
         imgdata.rawdata.raw_image = (ushort *)imgdata.rawdata.raw_alloc;
         if (!S.raw_pitch)
           S.raw_pitch = S.raw_width * 2; // Bayer case, not set before
@@ -401,6 +413,7 @@ int LibRaw::unpack(void)
           zero_rawimage = 1;
         }
       }
+      getbits_sync();
       ID.input->seek(libraw_internal_data.unpacker_data.data_offset, SEEK_SET);
 
       unsigned m_save = C.maximum;
@@ -409,6 +422,7 @@ int LibRaw::unpack(void)
           )
         C.maximum = 65535;
       (this->*load_raw)();
+      getbits_sync();
       if (zero_rawimage)
         imgdata.rawdata.raw_image = 0;
       if (load_raw == &LibRaw::unpacked_load_raw &&
@@ -447,8 +461,19 @@ int LibRaw::unpack(void)
       }
     }
 
+    if (libraw_internal_data.unpacker_data.rawband_ring)
+    {
+      // only the last band is left: no raw data to keep
+      free(imgdata.rawdata.raw_alloc);
+      imgdata.rawdata.raw_alloc = 0;
+      imgdata.rawdata.raw_image = 0;
+    }
+
     if (imgdata.rawdata.raw_image)
+    {
       crop_masked_pixels(); // calculate black levels
+      rawband_flush(S.raw_height, 1); // decoders without own band output
+    }
 
     // recover image sizes
     S.iwidth = save_iwidth;
@@ -491,3 +516,20 @@ int LibRaw::unpack(void)
     EXCEPTION_HANDLER(LIBRAW_EXCEPTION_IO_CORRUPT);
   }
 }
+
+int LibRaw::unpack_roi(int left, int top, int width, int height)
+{
+  CHECK_ORDER_HIGH(LIBRAW_PROGRESS_LOAD_RAW);
+  CHECK_ORDER_LOW(LIBRAW_PROGRESS_IDENTIFY);
+  if (left < 0 || top < 0 || width < 1 || height < 1 ||
+      left + width > S.width || top + height > S.height)
+    return LIBRAW_BAD_CROP;
+
+  libraw_internal_data.unpacker_data.roi_left = left;
+  libraw_internal_data.unpacker_data.roi_top = top;
+  libraw_internal_data.unpacker_data.roi_width = width;
+  libraw_internal_data.unpacker_data.roi_height = height;
+  int ret = unpack();
+  libraw_internal_data.unpacker_data.roi_width = 0;
+  return ret;
+}
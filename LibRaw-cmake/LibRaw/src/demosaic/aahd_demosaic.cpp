@@ -88,6 +88,7 @@ struct AAHD
   void make_ahd_rb_hv(int i);
   void make_ahd_rb_last(int i);
   void evaluate_ahd();
+  void evaluate_homo_line(int i);
   void combine_image();
   void hide_hots();
   void refine_hv_dirs();
@@ -293,15 +294,70 @@ void AAHD::hide_hots()
   }
 }
 
-void AAHD::evaluate_ahd()
+void AAHD::evaluate_homo_line(int i)
 {
   int hvdir[4] = {Pw, Pe, Pn, Ps};
+  int moff = nr_offset(i + nr_margin, nr_margin);
+  for (int j = 0; j < libraw.imgdata.sizes.iwidth; j++, ++moff)
+  {
+    int3 *ynr;
+    float ydiff[2][4];
+    int uvdiff[2][4];
+    for (int d = 0; d < 2; ++d)
+    {
+      ynr = &yuv[d][moff];
+      for (int k = 0; k < 4; k++)
+      {
+        ydiff[d][k] = ABS(ynr[0][0] - ynr[hvdir[k]][0]);
+        uvdiff[d][k] = SQR(ynr[0][1] - ynr[hvdir[k]][1]) +
+                       SQR(ynr[0][2] - ynr[hvdir[k]][2]);
+      }
+    }
+    float yeps =
+        MIN(MAX(ydiff[0][0], ydiff[0][1]), MAX(ydiff[1][2], ydiff[1][3]));
+    int uveps =
+        MIN(MAX(uvdiff[0][0], uvdiff[0][1]), MAX(uvdiff[1][2], uvdiff[1][3]));
+    for (int d = 0; d < 2; d++)
+    {
+      ynr = &yuv[d][moff];
+      for (int k = 0; k < 4; k++)
+        if (ydiff[d][k] <= yeps && uvdiff[d][k] <= uveps)
+        {
+          homo[d][moff + hvdir[k]]++;
+          if (k / 2 == d)
+          {
+            // если в сонаправленном направлении интеполяции следующие точки
+            // так же гомогенны, учтём их тоже
+            for (int m = 2; m < 4; ++m)
+            {
+              int hvd = m * hvdir[k];
+              if (ABS(ynr[0][0] - ynr[hvd][0]) < yeps &&
+                  SQR(ynr[0][1] - ynr[hvd][1]) +
+                          SQR(ynr[0][2] - ynr[hvd][2]) <
+                      uveps)
+              {
+                homo[d][moff + hvd]++;
+              }
+              else
+                break;
+            }
+          }
+        }
+    }
+  }
+}
+
+void AAHD::evaluate_ahd()
+{
   /*
    * YUV
    *
    */
   for (int d = 0; d < 2; ++d)
   {
+#if defined(LIBRAW_USE_OPENMP)
+#pragma omp parallel for schedule(static)
+#endif
     for (int i = 0; i < nr_width * nr_height; ++i)
     {
       ushort3 rgb;
@@ -350,57 +406,28 @@ void AAHD::evaluate_ahd()
    }
    }
    * Lab */
-  for (int i = 0; i < libraw.imgdata.sizes.iheight; ++i)
+  /*
+   * homo[] is bumped up to 3 rows away from the row being evaluated: rows
+   * go in bands of 8, even bands in parallel first, then odd ones
+   */
+  int nbands = (libraw.imgdata.sizes.iheight + 7) / 8;
+  for (int pass = 0; pass < 2; ++pass)
   {
-    int moff = nr_offset(i + nr_margin, nr_margin);
-    for (int j = 0; j < libraw.imgdata.sizes.iwidth; j++, ++moff)
+#if defined(LIBRAW_USE_OPENMP)
+#pragma omp parallel for schedule(guided)
+#endif
+    for (int band = pass; band < nbands; band += 2)
     {
-      int3 *ynr;
-      float ydiff[2][4];
-      int uvdiff[2][4];
-      for (int d = 0; d < 2; ++d)
-      {
-        ynr = &yuv[d][moff];
-        for (int k = 0; k < 4; k++)
-        {
-          ydiff[d][k] = ABS(ynr[0][0] - ynr[hvdir[k]][0]);
-          uvdiff[d][k] = SQR(ynr[0][1] - ynr[hvdir[k]][1]) +
-                         SQR(ynr[0][2] - ynr[hvdir[k]][2]);
-        }
-      }
-      float yeps =
-          MIN(MAX(ydiff[0][0], ydiff[0][1]), MAX(ydiff[1][2], ydiff[1][3]));
-      int uveps =
-          MIN(MAX(uvdiff[0][0], uvdiff[0][1]), MAX(uvdiff[1][2], uvdiff[1][3]));
-      for (int d = 0; d < 2; d++)
+      int iend = MIN(band * 8 + 8, libraw.imgdata.sizes.iheight);
+      for (int i = band * 8; i < iend; ++i)
       {
-        ynr = &yuv[d][moff];
-        for (int k = 0; k < 4; k++)
-          if (ydiff[d][k] <= yeps && uvdiff[d][k] <= uveps)
-          {
-            homo[d][moff + hvdir[k]]++;
-            if (k / 2 == d)
-            {
-              // если в сонаправленном направлении интеполяции следующие точки
-              // так же гомогенны, учтём их тоже
-              for (int m = 2; m < 4; ++m)
-              {
-                int hvd = m * hvdir[k];
-                if (ABS(ynr[0][0] - ynr[hvd][0]) < yeps &&
-                    SQR(ynr[0][1] - ynr[hvd][1]) +
-                            SQR(ynr[0][2] - ynr[hvd][2]) <
-                        uveps)
-                {
-                  homo[d][moff + hvd]++;
-                }
-                else
-                  break;
-              }
-            }
-          }
+        evaluate_homo_line(i);
       }
     }
   }
+#if defined(LIBRAW_USE_OPENMP)
+#pragma omp parallel for schedule(guided)
+#endif
   for (int i = 0; i < libraw.imgdata.sizes.iheight; ++i)
   {
     int moff = nr_offset(i + nr_margin, nr_margin);
@@ -469,8 +496,12 @@ void AAHD::evaluate_ahd()
 
 void AAHD::combine_image()
 {
-  for (int i = 0, i_out = 0; i < libraw.imgdata.sizes.iheight; ++i)
+#if defined(LIBRAW_USE_OPENMP)
+#pragma omp parallel for schedule(guided)
+#endif
+  for (int i = 0; i < libraw.imgdata.sizes.iheight; ++i)
   {
+    int i_out = i * libraw.imgdata.sizes.iwidth;
     int moff = nr_offset(i + nr_margin, nr_margin);
     for (int j = 0; j < libraw.imgdata.sizes.iwidth; j++, ++moff, ++i_out)
     {
@@ -500,14 +531,21 @@ void AAHD::combine_image()
 
 void AAHD::refine_hv_dirs()
 {
+#if defined(LIBRAW_USE_OPENMP)
+#pragma omp parallel for schedule(guided)
+#endif
   for (int i = 0; i < libraw.imgdata.sizes.iheight; ++i)
   {
     refine_hv_dirs(i, i & 1);
   }
+#if defined(LIBRAW_USE_OPENMP)
+#pragma omp parallel for schedule(guided)
+#endif
   for (int i = 0; i < libraw.imgdata.sizes.iheight; ++i)
   {
     refine_hv_dirs(i, (i & 1) ^ 1);
   }
+  /* in place over all pixels, stays serial to keep the result */
   for (int i = 0; i < libraw.imgdata.sizes.iheight; ++i)
   {
     refine_ihv_dirs(i);
@@ -574,6 +612,9 @@ void AAHD::refine_hv_dirs(int i, int js)
  */
 void AAHD::make_ahd_greens()
 {
+#if defined(LIBRAW_USE_OPENMP)
+#pragma omp parallel for schedule(guided)
+#endif
   for (int i = 0; i < libraw.imgdata.sizes.iheight; ++i)
   {
     make_ahd_gline(i);
@@ -693,10 +734,16 @@ void AAHD::make_ahd_rb_hv(int i)
 
 void AAHD::make_ahd_rb()
 {
+#if defined(LIBRAW_USE_OPENMP)
+#pragma omp parallel for schedule(guided)
+#endif
   for (int i = 0; i < libraw.imgdata.sizes.iheight; ++i)
   {
     make_ahd_rb_hv(i);
   }
+#if defined(LIBRAW_USE_OPENMP)
+#pragma omp parallel for schedule(guided)
+#endif
   for (int i = 0; i < libraw.imgdata.sizes.iheight; ++i)
   {
     make_ahd_rb_last(i);
@@ -23,12 +23,17 @@
    the work of Keigo Hirakawa, Thomas Parks, and Paul Lee.
  */
 
+#ifdef LIBRAW_NOTHREADS
+static float ahd_cbrt[0x10000], ahd_xyz_cam[3][4];
+#endif
+
 void LibRaw::cielab(ushort rgb[3], short lab[3])
 {
   int c, i, j, k;
   float r, xyz[3];
 #ifdef LIBRAW_NOTHREADS
-  static float cbrt[0x10000], xyz_cam[3][4];
+#define cbrt ahd_cbrt
+#define xyz_cam ahd_xyz_cam
 #else
 #define cbrt tls->ahd_data.cbrt
 #define xyz_cam tls->ahd_data.xyz_cam
@@ -65,10 +70,43 @@ void LibRaw::cielab(ushort rgb[3], short lab[3])
   lab[0] = 64 * (116 * xyz[1] - 16);
   lab[1] = 64 * 500 * (xyz[0] - xyz[1]);
   lab[2] = 64 * 200 * (xyz[1] - xyz[2]);
-#ifndef LIBRAW_NOTHREADS
 #undef cbrt
 #undef xyz_cam
+}
+
+/* cielab() for a run of up to LIBRAW_AHD_TILE pixels: XYZ table indexes
+   first, then the cbrt[] lookups and Lab in a separate pass */
+void LibRaw::cielab_row(ushort (*rgb)[3], short (*lab)[3], int count)
+{
+#ifdef LIBRAW_NOTHREADS
+  float *cbrt = ahd_cbrt;
+  float(*xyz_cam)[4] = ahd_xyz_cam;
+#else
+  float *cbrt = tls->ahd_data.cbrt;
+  float(*xyz_cam)[4] = tls->ahd_data.xyz_cam;
 #endif
+  int idx[3][LIBRAW_AHD_TILE];
+  int i, k;
+
+  for (k = 0; k < 3; k++)
+  {
+    float m0 = xyz_cam[k][0], m1 = xyz_cam[k][1], m2 = xyz_cam[k][2];
+    for (i = 0; i < count; i++)
+    {
+      float xyz = 0.5;
+      xyz += m0 * rgb[i][0];
+      xyz += m1 * rgb[i][1];
+      xyz += m2 * rgb[i][2];
+      idx[k][i] = CLIP((int)xyz);
+    }
+  }
+  for (i = 0; i < count; i++)
+  {
+    float x = cbrt[idx[0][i]], y = cbrt[idx[1][i]], z = cbrt[idx[2][i]];
+    lab[i][0] = 64 * (116 * y - 16);
+    lab[i][1] = 64 * 500 * (x - y);
+    lab[i][2] = 64 * 200 * (y - z);
+  }
 }
 
 void LibRaw::ahd_interpolate_green_h_and_v(
@@ -106,7 +144,6 @@ void LibRaw::ahd_interpolate_r_and_b_in_rgb_and_convert_to_cielab(
   int c, val;
   ushort(*pix)[4];
   ushort(*rix)[3];
-  short(*lix)[3];
   const unsigned num_pix_per_row = 4 * width;
   const unsigned rowlimit = MIN(top + LIBRAW_AHD_TILE - 1, height - 3);
   const unsigned collimit = MIN(left + LIBRAW_AHD_TILE - 1, width - 3);
@@ -118,7 +155,6 @@ void LibRaw::ahd_interpolate_r_and_b_in_rgb_and_convert_to_cielab(
   {
     pix = image + row * width + left;
     rix = &inout_rgb[row - top][0];
-    lix = &out_lab[row - top][0];
 
     for (col = left + 1; col < collimit; col++)
     {
@@ -126,7 +162,6 @@ void LibRaw::ahd_interpolate_r_and_b_in_rgb_and_convert_to_cielab(
       pix_above = &pix[0][0] - num_pix_per_row;
       pix_below = &pix[0][0] + num_pix_per_row;
       rix++;
-      lix++;
 
       c = 2 - FC(row, col);
 
@@ -156,8 +191,9 @@ void LibRaw::ahd_interpolate_r_and_b_in_rgb_and_convert_to_cielab(
       rix[0][c] = CLIP(val);
       c = FC(row, col);
       rix[0][c] = pix[0][c];
-      cielab(rix[0], lix[0]);
     }
+    cielab_row(&inout_rgb[row - top][1], &out_lab[row - top][1],
+               int(collimit) - left - 1);
   }
 }
 void LibRaw::ahd_interpolate_r_and_b_and_convert_to_cielab(
@@ -223,12 +259,8 @@ void LibRaw::ahd_interpolate_build_homogeneity_map(
       {
         homogeneity = 0;
         for (i = 0; i < 4; i++)
-        {
-          if (ldiff[direction][i] <= leps && abdiff[direction][i] <= abeps)
-          {
-            homogeneity++;
-          }
-        }
+          homogeneity +=
+              (ldiff[direction][i] <= leps) & (abdiff[direction][i] <= abeps);
         homogeneity_map_p[0][direction] = homogeneity;
       }
     }
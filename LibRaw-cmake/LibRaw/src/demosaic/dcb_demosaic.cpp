@@ -46,6 +46,9 @@ void LibRaw::dcb_ver(float (*image3)[3])
 {
   int row, col, u = width, indx;
 
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) private(col, indx)
+#endif
   for (row = 2; row < height - 2; row++)
     for (col = 2 + (FC(row, 2) & 1), indx = row * width + col; col < u - 2;
          col += 2, indx += 2)
@@ -60,6 +63,9 @@ void LibRaw::dcb_hor(float (*image2)[3])
 {
   int row, col, u = width, indx;
 
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) private(col, indx)
+#endif
   for (row = 2; row < height - 2; row++)
     for (col = 2 + (FC(row, 2) & 1), indx = row * width + col; col < u - 2;
          col += 2, indx += 2)
@@ -70,11 +76,17 @@ void LibRaw::dcb_hor(float (*image2)[3])
 }
 
 // missing colors are interpolated
+// (R/B sites only read native colors of their diagonals and G sites only
+// native colors of their direct neighbours, so both go in one row pass)
 void LibRaw::dcb_color()
 {
   int row, col, c, d, u = width, indx;
 
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) private(col, c, d, indx)
+#endif
   for (row = 1; row < height - 1; row++)
+  {
     for (col = 1 + (FC(row, 1) & 1), indx = row * width + col,
         c = 2 - FC(row, col);
          col < u - 1; col += 2, indx += 2)
@@ -88,7 +100,6 @@ void LibRaw::dcb_color()
                             4.0);
     }
 
-  for (row = 1; row < height - 1; row++)
     for (col = 1 + (FC(row, 2) & 1), indx = row * width + col,
         c = FC(row, col + 1), d = 2 - c;
          col < width - 1; col += 2, indx += 2)
@@ -103,6 +114,7 @@ void LibRaw::dcb_color()
                 image[indx + u][d] + image[indx - u][d]) /
                2.0);
     }
+  }
 }
 
 // missing R and B are interpolated horizontally and saved in image2
@@ -110,7 +122,11 @@ void LibRaw::dcb_color2(float (*image2)[3])
 {
   int row, col, c, d, u = width, indx;
 
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) private(col, c, d, indx)
+#endif
   for (row = 1; row < height - 1; row++)
+  {
     for (col = 1 + (FC(row, 1) & 1), indx = row * width + col,
         c = 2 - FC(row, col);
          col < u - 1; col += 2, indx += 2)
@@ -125,7 +141,6 @@ void LibRaw::dcb_color2(float (*image2)[3])
                4.0);
     }
 
-  for (row = 1; row < height - 1; row++)
     for (col = 1 + (FC(row, 2) & 1), indx = row * width + col,
         c = FC(row, col + 1), d = 2 - c;
          col < width - 1; col += 2, indx += 2)
@@ -137,6 +152,7 @@ void LibRaw::dcb_color2(float (*image2)[3])
                 image2[indx - u][1] + image[indx + u][d] + image[indx - u][d]) /
                2.0);
     }
+  }
 }
 
 // missing R and B are interpolated vertically and saved in image3
@@ -144,7 +160,11 @@ void LibRaw::dcb_color3(float (*image3)[3])
 {
   int row, col, c, d, u = width, indx;
 
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) private(col, c, d, indx)
+#endif
   for (row = 1; row < height - 1; row++)
+  {
     for (col = 1 + (FC(row, 1) & 1), indx = row * width + col,
         c = 2 - FC(row, col);
          col < u - 1; col += 2, indx += 2)
@@ -159,7 +179,6 @@ void LibRaw::dcb_color3(float (*image3)[3])
                4.0);
     }
 
-  for (row = 1; row < height - 1; row++)
     for (col = 1 + (FC(row, 2) & 1), indx = row * width + col,
         c = FC(row, col + 1), d = 2 - c;
          col < width - 1; col += 2, indx += 2)
@@ -171,6 +190,7 @@ void LibRaw::dcb_color3(float (*image3)[3])
                2.0);
       image3[indx][d] = CLIP((image[indx + u][d] + image[indx - u][d]) / 2.0);
     }
+  }
 }
 
 // decides the primary green interpolation direction
@@ -179,6 +199,10 @@ void LibRaw::dcb_decide(float (*image2)[3], float (*image3)[3])
   int row, col, c, d, u = width, v = 2 * u, indx;
   float current, current2, current3;
 
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) private(col, c, d, indx, current,   \
+                                                  current2, current3)
+#endif
   for (row = 2; row < height - 2; row++)
     for (col = 2 + (FC(row, 2) & 1), indx = row * width + col, c = FC(row, col);
          col < u - 2; col += 2, indx += 2)
@@ -239,6 +263,9 @@ void LibRaw::dcb_copy_to_buffer(float (*image2)[3])
 {
   int indx;
 
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
   for (indx = 0; indx < height * width; indx++)
   {
     image2[indx][0] = image[indx][0]; // R
@@ -251,6 +278,9 @@ void LibRaw::dcb_restore_from_buffer(float (*image2)[3])
 {
   int indx;
 
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
   for (indx = 0; indx < height * width; indx++)
   {
     image[indx][0] = image2[indx][0]; // R
@@ -317,6 +347,9 @@ void LibRaw::dcb_color_full()
 
   chroma = (float(*)[2])calloc(width * height, sizeof *chroma);
 
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) private(col, c, d, indx)
+#endif
   for (row = 1; row < height - 1; row++)
     for (col = 1 + (FC(row, 1) & 1), indx = row * width + col, c = FC(row, col),
         d = c / 2;
@@ -450,6 +483,9 @@ void LibRaw::dcb_map()
 {
   int row, col, u = width, indx;
 
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) private(col, indx)
+#endif
   for (row = 1; row < height - 1; row++)
   {
     for (col = 1, indx = row * width + col; col < width - 1; col++, indx++)
@@ -476,6 +512,9 @@ void LibRaw::dcb_correction()
 {
   int current, row, col, u = width, v = 2 * u, indx;
 
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) private(col, indx, current)
+#endif
   for (row = 2; row < height - 2; row++)
     for (col = 2 + (FC(row, 2) & 1), indx = row * width + col; col < u - 2;
          col += 2, indx += 2)
@@ -500,6 +539,9 @@ void LibRaw::dcb_correction2()
 {
   int current, row, col, c, u = width, v = 2 * u, indx;
 
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) private(col, c, indx, current)
+#endif
   for (row = 4; row < height - 4; row++)
     for (col = 4 + (FC(row, 2) & 1), indx = row * width + col, c = FC(row, col);
          col < u - 4; col += 2, indx += 2)
@@ -633,6 +675,9 @@ void LibRaw::dcb_refinement()
 void LibRaw::rgb_to_lch(double (*image2)[3])
 {
   int indx;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
   for (indx = 0; indx < height * width; indx++)
   {
 
@@ -647,6 +692,9 @@ void LibRaw::rgb_to_lch(double (*image2)[3])
 void LibRaw::lch_to_rgb(double (*image2)[3])
 {
   int indx;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
   for (indx = 0; indx < height * width; indx++)
   {
 
@@ -663,6 +711,9 @@ void LibRaw::fbdd_correction()
 {
   int row, col, c, u = width, indx;
 
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) private(col, c, indx)
+#endif
   for (row = 2; row < height - 2; row++)
   {
     for (col = 2, indx = row * width + col; col < width - 2; col++, indx++)
@@ -105,6 +105,9 @@ void LibRaw::border_interpolate(int border)
 void LibRaw::lin_interpolate_loop(int *code, int size)
 {
   int row;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(none) firstprivate(code, size)
+#endif
   for (row = 1; row < height - 1; row++)
   {
     int col, *ip;
@@ -166,6 +169,68 @@ void LibRaw::lin_interpolate()
   RUN_CALLBACK(LIBRAW_PROGRESS_INTERPOLATE, 2, 3);
 }
 
+void LibRaw::vng_interpolate_row(int row, int *code[16][16], int prow,
+                                 int pcol, ushort (*brow)[4])
+{
+  ushort *pix;
+  int col, *ip, gval[8], gmin, gmax, sum[4];
+  int t, color, g, diff, thold, num, c;
+
+  for (col = 2; col < width - 2; col++)
+  {
+    pix = image[row * width + col];
+    ip = code[row % prow][col % pcol];
+    memset(gval, 0, sizeof gval);
+    while ((g = ip[0]) != INT_MAX)
+    { /* Calculate gradients */
+      diff = ABS(pix[g] - pix[ip[1]]) << ip[2];
+      gval[ip[3]] += diff;
+      ip += 5;
+      if ((g = ip[-1]) == -1)
+        continue;
+      gval[g] += diff;
+      while ((g = *ip++) != -1)
+        gval[g] += diff;
+    }
+    ip++;
+    gmin = gmax = gval[0]; /* Choose a threshold */
+    for (g = 1; g < 8; g++)
+    {
+      if (gmin > gval[g])
+        gmin = gval[g];
+      if (gmax < gval[g])
+        gmax = gval[g];
+    }
+    if (gmax == 0)
+    {
+      memcpy(brow[col], pix, sizeof *image);
+      continue;
+    }
+    thold = gmin + (gmax >> 1);
+    memset(sum, 0, sizeof sum);
+    color = fcol(row, col);
+    for (num = g = 0; g < 8; g++, ip += 2)
+    { /* Average the neighbors */
+      if (gval[g] <= thold)
+      {
+        FORCC
+        if (c == color && ip[1])
+          sum[c] += (pix[c] + pix[ip[1]]) >> 1;
+        else
+          sum[c] += pix[ip[0] + c];
+        num++;
+      }
+    }
+    FORCC
+    { /* Save to buffer */
+      t = pix[color];
+      if (c != color)
+        t += (sum[c] - sum[color]) / num;
+      brow[col][c] = CLIP(t);
+    }
+  }
+}
+
 /*
    This algorithm is officially called:
 
@@ -208,10 +273,9 @@ void LibRaw::vng_interpolate()
            +1, -1, +1,   +1, 0,  -120, +1, +0, +1,   +2, 0,  0x08, +1, +0, +2,
            -1, 0,  0x40, +1, +0, +2,   +1, 0,  0x10},
       chood[] = {-1, -1, -1, 0, -1, +1, 0, +1, +1, +1, +1, 0, +1, -1, 0, -1};
-  ushort(*brow[5])[4], *pix;
-  int prow = 8, pcol = 2, *ip, *code[16][16], gval[8], gmin, gmax, sum[4];
+  int prow = 8, pcol = 2, *ip, *code[16][16];
   int row, col, x, y, x1, x2, y1, y2, t, weight, grads, color, diag;
-  int g, diff, thold, num, c;
+  int g;
 
   lin_interpolate();
 
@@ -261,79 +325,83 @@ void LibRaw::vng_interpolate()
           *ip++ = 0;
       }
     }
-  brow[4] = (ushort(*)[4])calloc(width * 3, sizeof **brow);
-  for (row = 0; row < 3; row++)
-    brow[row] = brow[4] + row * width;
-  for (row = 2; row < height - 2; row++)
-  { /* Do VNG interpolation */
-    if (!((row - 2) % 256))
-      RUN_CALLBACK(LIBRAW_PROGRESS_INTERPOLATE, (row - 2) / 256 + 1,
-                   ((height - 3) / 256) + 1);
-    for (col = 2; col < width - 2; col++)
-    {
-      pix = image[row * width + col];
-      ip = code[row % prow][col % pcol];
-      memset(gval, 0, sizeof gval);
-      while ((g = ip[0]) != INT_MAX)
-      { /* Calculate gradients */
-        diff = ABS(pix[g] - pix[ip[1]]) << ip[2];
-        gval[ip[3]] += diff;
-        ip += 5;
-        if ((g = ip[-1]) == -1)
-          continue;
-        gval[g] += diff;
-        while ((g = *ip++) != -1)
-          gval[g] += diff;
-      }
-      ip++;
-      gmin = gmax = gval[0]; /* Choose a threshold */
-      for (g = 1; g < 8; g++)
-      {
-        if (gmin > gval[g])
-          gmin = gval[g];
-        if (gmax < gval[g])
-          gmax = gval[g];
-      }
-      if (gmax == 0)
+  /*
+     Rows go in bands of LIBRAW_VNG_BAND. A row reads the interpolated
+     image two rows up and down, so results are written back two rows late
+     (as the old rolling buffer did), and the first and last two rows of
+     each band wait in edge[] until every band is done.
+   */
+  int nbands = (height - 4 + LIBRAW_VNG_BAND - 1) / LIBRAW_VNG_BAND;
+  int terminate_flag = 0;
+  ushort(*edge)[4] =
+      (ushort(*)[4])calloc(size_t(MAX(nbands, 1)) * 4 * width, sizeof *edge);
+#ifdef LIBRAW_USE_OPENMP
+  int buffer_count = omp_get_max_threads();
+#else
+  int buffer_count = 1;
+#endif
+  char **buffers = malloc_omp_buffers(buffer_count, width * 3 * sizeof *image);
+
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(dynamic) default(none) shared(terminate_flag) firstprivate(buffers, edge, nbands, code, prow, pcol)
+#endif
+  for (int band = 0; band < nbands; band++)
+  {
+#ifdef LIBRAW_USE_OPENMP
+    if (0 == omp_get_thread_num())
+#endif
+      if (callbacks.progress_cb)
       {
-        memcpy(brow[2][col], pix, sizeof *image);
-        continue;
-      }
-      thold = gmin + (gmax >> 1);
-      memset(sum, 0, sizeof sum);
-      color = fcol(row, col);
-      for (num = g = 0; g < 8; g++, ip += 2)
-      { /* Average the neighbors */
-        if (gval[g] <= thold)
-        {
-          FORCC
-          if (c == color && ip[1])
-            sum[c] += (pix[c] + pix[ip[1]]) >> 1;
-          else
-            sum[c] += pix[ip[0] + c];
-          num++;
-        }
-      }
-      FORCC
-      { /* Save to buffer */
-        t = pix[color];
-        if (c != color)
-          t += (sum[c] - sum[color]) / num;
-        brow[2][col][c] = CLIP(t);
+        int rr = (*callbacks.progress_cb)(callbacks.progresscb_data,
+                                          LIBRAW_PROGRESS_INTERPOLATE, band,
+                                          nbands);
+        if (rr)
+          terminate_flag = 1;
       }
+#ifdef LIBRAW_USE_OPENMP
+    ushort(*brow)[4] = (ushort(*)[4])buffers[omp_get_thread_num()];
+#else
+    ushort(*brow)[4] = (ushort(*)[4])buffers[0];
+#endif
+    int top = 2 + band * LIBRAW_VNG_BAND;
+    int bottom = MIN(top + LIBRAW_VNG_BAND, height - 2);
+    for (int row = top; !terminate_flag && row < bottom; row++)
+    {
+      ushort(*out)[4] = brow + (row % 3) * width;
+      vng_interpolate_row(row, code, prow, pcol, out);
+      if (row < top + 2)
+        memcpy(edge + (band * 4 + row - top) * width + 2, out + 2,
+               (width - 4) * sizeof *image);
+      else if (row >= bottom - 2)
+        memcpy(edge + (band * 4 + row - bottom + 4) * width + 2, out + 2,
+               (width - 4) * sizeof *image);
+      if (row - 2 >= top + 2 && row - 2 < bottom - 2)
+        memcpy(image[(row - 2) * width + 2], brow + ((row - 2) % 3) * width + 2,
+               (width - 4) * sizeof *image);
     }
-    if (row > 3) /* Write buffer to image */
-      memcpy(image[(row - 2) * width + 2], brow[0] + 2,
-             (width - 4) * sizeof *image);
-    for (g = 0; g < 4; g++)
-      brow[(g - 1) & 3] = brow[g];
   }
-  memcpy(image[(row - 2) * width + 2], brow[0] + 2,
-         (width - 4) * sizeof *image);
-  memcpy(image[(row - 1) * width + 2], brow[1] + 2,
-         (width - 4) * sizeof *image);
-  free(brow[4]);
+  free_omp_buffers(buffers, buffer_count);
+
+  if (!terminate_flag)
+    for (int band = 0; band < nbands; band++)
+    {
+      int top = 2 + band * LIBRAW_VNG_BAND;
+      int bottom = MIN(top + LIBRAW_VNG_BAND, height - 2);
+      for (row = top; row < bottom; row++)
+        if (row < top + 2)
+          memcpy(image[row * width + 2],
+                 edge + (band * 4 + row - top) * width + 2,
+                 (width - 4) * sizeof *image);
+        else if (row >= bottom - 2)
+          memcpy(image[row * width + 2],
+                 edge + (band * 4 + row - bottom + 4) * width + 2,
+                 (width - 4) * sizeof *image);
+    }
+  free(edge);
   free(code[0][0]);
+
+  if (terminate_flag)
+    throw LIBRAW_EXCEPTION_CANCELLED_BY_CALLBACK;
 }
 
 /*
@@ -153,6 +153,14 @@ extern "C"
     LibRaw *ip = (LibRaw *)lr->parent_class;
     return ip->unpack();
   }
+  int libraw_unpack_roi(libraw_data_t *lr, int left, int top, int width,
+                        int height)
+  {
+    if (!lr)
+      return EINVAL;
+    LibRaw *ip = (LibRaw *)lr->parent_class;
+    return ip->unpack_roi(left, top, width, height);
+  }
   int libraw_unpack_thumb(libraw_data_t *lr)
   {
     if (!lr)
@@ -214,6 +222,14 @@ extern "C"
     LibRaw *ip = (LibRaw *)lr->parent_class;
     ip->set_progress_handler(cb, data);
   }
+  void libraw_set_rawband_handler(libraw_data_t *lr, rawband_callback cb,
+                                  void *data)
+  {
+    if (!lr)
+      return;
+    LibRaw *ip = (LibRaw *)lr->parent_class;
+    ip->set_rawband_handler(cb, data);
+  }
 
   // DCRAW
   int libraw_adjust_sizes_info_only(libraw_data_t *lr)
@@ -268,6 +284,30 @@ extern "C"
     LibRaw *ip = (LibRaw *)lr->parent_class;
     return ip->dcraw_make_mem_thumb(errc);
   }
+  libraw_processed_image_t *libraw_dcraw_make_half_image(libraw_data_t *lr,
+                                                         int *errc)
+  {
+    if (!lr)
+    {
+      if (errc)
+        *errc = EINVAL;
+      return NULL;
+    }
+    LibRaw *ip = (LibRaw *)lr->parent_class;
+    return ip->dcraw_make_half_image(errc);
+  }
+  libraw_processed_image_t *libraw_raw_bin(libraw_data_t *lr, int factor,
+                                           int bits, int *errc)
+  {
+    if (!lr)
+    {
+      if (errc)
+        *errc = EINVAL;
+      return NULL;
+    }
+    LibRaw *ip = (LibRaw *)lr->parent_class;
+    return ip->raw_bin(factor, bits, errc);
+  }
 
   void libraw_dcraw_clear_mem(libraw_processed_image_t *p)
   {
@@ -295,6 +335,13 @@ extern "C"
     LibRaw *ip = (LibRaw *)lr->parent_class;
     return ip->get_decoder_info(d);
   }
+  int libraw_get_memstats(libraw_data_t *lr, libraw_memstats_t *m)
+  {
+    if (!lr || !m)
+      return EINVAL;
+    LibRaw *ip = (LibRaw *)lr->parent_class;
+    return ip->get_memstats(m);
+  }
   int libraw_COLOR(libraw_data_t *lr, int row, int col)
   {
     if (!lr)
@@ -27,6 +27,10 @@
 #include "libraw/libraw_types.h"
 #include "libraw/libraw_datastream.h"
 #include <sys/stat.h>
+#ifndef LIBRAW_WIN32_CALLS
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 #ifdef USE_JASPER
 #include <jasper/jasper.h> /* Decode RED camera movies */
 #else
@@ -152,6 +156,12 @@ int LibRaw_abstract_datastream::jpeg_src(void *jpegdata)
 #endif
 }
 
+int LibRaw_abstract_datastream::read_at(void *ptr, size_t size, INT64 offset)
+{
+  seek(offset, SEEK_SET);
+  return read(ptr, 1, size);
+}
+
 
 #ifndef LIBRAW_NO_IOSTREAMS_DATASTREAM
 // == LibRaw_file_datastream ==
@@ -374,6 +384,16 @@ int LibRaw_buffer_datastream::read(void *ptr, size_t sz, size_t nmemb)
   return int((to_read + sz - 1) / (sz > 0 ? sz : 1));
 }
 
+int LibRaw_buffer_datastream::read_at(void *ptr, size_t size, INT64 offset)
+{
+  if (offset < 0 || size_t(offset) >= streamsize)
+    return 0;
+  if (size > streamsize - size_t(offset))
+    size = streamsize - size_t(offset);
+  memmove(ptr, buf + offset, size);
+  return int(size);
+}
+
 int LibRaw_buffer_datastream::seek(INT64 o, int whence)
 {
   switch (whence)
@@ -584,6 +604,30 @@ int LibRaw_bigfile_datastream::read(void *ptr, size_t size, size_t nmemb)
   return int(fread(ptr, size, nmemb, f));
 }
 
+#ifndef LIBRAW_WIN32_CALLS
+int LibRaw_bigfile_datastream::read_at(void *ptr, size_t size, INT64 offset)
+{
+  LR_BF_CHK();
+  size_t done = 0;
+  while (done < size)
+  {
+    ssize_t r = pread(fileno(f), (char *)ptr + done, size - done, off_t(offset + done));
+    if (r <= 0)
+      break;
+    done += size_t(r);
+  }
+  return int(done);
+}
+
+void LibRaw_bigfile_datastream::read_ahead(INT64 offset, size_t size)
+{
+#ifdef POSIX_FADV_WILLNEED
+  if (f)
+    posix_fadvise(fileno(f), off_t(offset), off_t(size), POSIX_FADV_WILLNEED);
+#endif
+}
+#endif
+
 int LibRaw_bigfile_datastream::eof()
 {
   LR_BF_CHK();
@@ -290,3 +290,554 @@ void LibRaw::dcraw_clear_mem(libraw_processed_image_t *p)
   if (p)
     ::free(p);
 }
+
+int LibRaw::half_image_supported()
+{
+  // Everything the fused path does not replicate goes through dcraw_process()
+  if (imgdata.rawdata.iparams.filters <= 1000 ||
+      imgdata.rawdata.iparams.colors != 3 || !imgdata.rawdata.raw_image ||
+      imgdata.rawdata.ioparams.fuji_width ||
+      imgdata.rawdata.ioparams.zero_is_bad || is_phaseone_compressed() ||
+      is_canon_600())
+    return 0;
+  if (O.use_auto_wb ||
+      (O.use_camera_wb &&
+       (imgdata.rawdata.color.cam_mul[0] < -0.5 ||
+        (imgdata.rawdata.color.cam_mul[0] <= 0.00001f &&
+         !(imgdata.rawparams.options &
+           LIBRAW_RAWOPTIONS_CAMERAWB_FALLBACK_TO_DAYLIGHT)))))
+    return 0;
+  if (O.highlight > 1 || O.threshold || O.four_color_rgb || O.aber[0] != 1 ||
+      O.aber[2] != 1 || O.bad_pixels || O.dark_frame ||
+      (~O.cropbox[2] && ~O.cropbox[3]) || O.exp_correc > 0 ||
+      O.med_passes > 0 || O.no_auto_scale)
+    return 0;
+#ifndef NO_LCMS
+  if (O.camera_profile)
+    return 0;
+#endif
+  // adjust_bl() folds black patterns up to 2x2 into cblack[0..3]; larger
+  // ones are subtracted by scale_colors() at half-size coordinates
+  unsigned *cblack = imgdata.rawdata.color.cblack;
+  int user_black = O.user_black >= 0;
+  for (int c = 0; c < 4; c++)
+    if (O.user_cblack[c] > -1000000)
+      user_black = 1;
+  if (cblack[4] && cblack[5] && (cblack[4] > 2 || cblack[5] > 2) &&
+      !user_black)
+    return 0;
+  if (O.use_fuji_rotate && (imgdata.rawdata.sizes.pixel_aspect < 0.995 ||
+                            imgdata.rawdata.sizes.pixel_aspect > 1.005))
+    return 0;
+  if (callbacks.pre_subtractblack_cb || callbacks.pre_scalecolors_cb ||
+      callbacks.pre_preinterpolate_cb || callbacks.pre_interpolate_cb ||
+      callbacks.post_interpolate_cb || callbacks.pre_converttorgb_cb ||
+      callbacks.post_converttorgb_cb)
+    return 0;
+  return 1;
+}
+
+// Collects one half-size row (two CFA rows) with black levels subtracted
+void LibRaw::half_image_gather(int hrow, ushort (*quad)[4], const int cblk[4],
+                               ushort *dmaxp)
+{
+  int rows = MIN(int(S.height), int(S.raw_height) - int(S.top_margin));
+  int cols = MIN(int(S.width), int(S.raw_width) - int(S.left_margin));
+  ushort dmax = 0;
+
+  memset(quad, 0, ((S.width + 1) >> 1) * sizeof(*quad));
+  for (int row = hrow * 2; row < hrow * 2 + 2 && row < rows; row++)
+  {
+    ushort *raw = imgdata.rawdata.raw_image +
+                  (row + S.top_margin) * S.raw_pitch / 2 + S.left_margin;
+    int fc[2] = {FC(row, 0), FC(row, 1)};
+    for (int col = 0; col < cols; col++)
+    {
+      int c = fc[col & 1];
+      int val = raw[col] - cblk[c];
+      if (val > 0)
+      {
+        if (dmax < val)
+          dmax = val;
+      }
+      else
+        val = 0;
+      quad[col >> 1][c] = val;
+    }
+  }
+  if (*dmaxp < dmax)
+    *dmaxp = dmax;
+}
+
+// scale_colors(), green mixing and convert_to_rgb() for a run of pixels;
+// the output RGB replaces the first three channels in place
+void LibRaw::half_image_render(ushort (*quad)[4], int count,
+                               const float scale_mul[4], float out_cam[3][4],
+                               int (*hist)[LIBRAW_HISTOGRAM_SIZE])
+{
+  int raw_color = libraw_internal_data.internal_output_params.raw_color;
+  for (int i = 0; i < count; i++)
+  {
+    int pix[4], c;
+    for (c = 0; c < 4; c++)
+    {
+      int val = quad[i][c];
+      val *= scale_mul[c];
+      pix[c] = CLIP(val);
+    }
+    pix[1] = (pix[1] + pix[3]) >> 1;
+    if (!raw_color)
+    {
+      float out[3];
+      for (c = 0; c < 3; c++)
+        out[c] = out_cam[c][0] * pix[0] + out_cam[c][1] * pix[1] +
+                 out_cam[c][2] * pix[2];
+      for (c = 0; c < 3; c++)
+        pix[c] = CLIP((int)out[c]);
+    }
+    for (c = 0; c < 3; c++)
+    {
+      quad[i][c] = pix[c];
+      hist[c][pix[c] >> 3]++;
+    }
+  }
+}
+
+// Writes one rendered half-size row through the tone curve, applying flip
+void LibRaw::half_image_emit(ushort (*quad)[4], int hrow,
+                             libraw_processed_image_t *img)
+{
+  int ih = (S.height + 1) >> 1, iw = (S.width + 1) >> 1;
+  int stride = img->width * 3 * (img->bits / 8);
+  for (int col = 0; col < iw; col++)
+  {
+    int r = (S.flip & 2) ? ih - 1 - hrow : hrow;
+    int c = (S.flip & 1) ? iw - 1 - col : col;
+    if (S.flip & 4)
+      SWAP(r, c);
+    if (img->bits == 8)
+    {
+      uchar *ppm = img->data + r * stride + c * 3;
+      for (int k = 0; k < 3; k++)
+        ppm[k] = imgdata.color.curve[quad[col][k]] >> 8;
+    }
+    else
+    {
+      ushort *ppm2 = (ushort *)(img->data + r * stride) + c * 3;
+      for (int k = 0; k < 3; k++)
+        ppm2[k] = imgdata.color.curve[quad[col][k]];
+    }
+  }
+}
+
+libraw_processed_image_t *LibRaw::dcraw_make_half_image(int *errcode)
+{
+  if ((imgdata.progress_flags & LIBRAW_PROGRESS_THUMB_MASK) <
+      LIBRAW_PROGRESS_LOAD_RAW)
+  {
+    if (errcode)
+      *errcode = LIBRAW_OUT_OF_ORDER_CALL;
+    return NULL;
+  }
+
+  if (!half_image_supported())
+  {
+    int save_half = O.half_size;
+    O.half_size = 1;
+    int rc = dcraw_process();
+    O.half_size = save_half;
+    if (rc != LIBRAW_SUCCESS)
+    {
+      if (errcode)
+        *errcode = rc;
+      return NULL;
+    }
+    return dcraw_make_mem_image(errcode);
+  }
+
+  libraw_processed_image_t *ret = NULL;
+  ushort(*half)[4] = NULL;
+  char **buffers = NULL;
+  int rc = 0;
+#ifdef LIBRAW_USE_OPENMP
+  int buffer_count = omp_get_max_threads();
+#else
+  int buffer_count = 1;
+#endif
+
+  try
+  {
+    raw2image_start();
+    adjust_bl();
+
+    int ih = (S.height + 1) >> 1, iw = (S.width + 1) >> 1;
+    int cblk[4], c;
+    for (c = 0; c < 4; c++)
+      cblk[c] = C.cblack[c];
+    // same state raw2image_ex() leaves after inline black subtraction
+    C.maximum -= C.black;
+    C.cblack[0] = C.cblack[1] = C.cblack[2] = C.cblack[3] = 0;
+    C.black = 0;
+
+    if (O.user_mul[0])
+      memcpy(C.pre_mul, O.user_mul, sizeof C.pre_mul);
+    scale_colors_wb();
+
+    libraw_decoder_info_t di;
+    get_decoder_info(&di);
+    // with a known maximum the CFA rows are rendered right after gathering
+    int fused = (di.decoder_flags & LIBRAW_DECODER_FIXEDMAXC) ||
+                O.adjust_maximum_thr < 0.00001 || O.user_sat > 0;
+    int auto_bright = !((O.highlight & ~2) || O.no_auto_bright);
+
+    float scale_mul[4], out_cam[3][4];
+    if (fused)
+    {
+      if (O.user_sat > 0)
+        C.maximum = O.user_sat;
+      scale_colors_mul(scale_mul);
+    }
+    convert_to_rgb_matrix(out_cam);
+    gamma_curve(O.gamm[0], O.gamm[1], 0, 0);
+    if (!auto_bright)
+      gamma_curve(O.gamm[0], O.gamm[1], 2, (0x2000 << 3) / O.bright);
+
+    int width = iw, height = ih;
+    if (S.flip & 4)
+      SWAP(width, height);
+    int stride = width * (O.output_bps / 8) * 3;
+    unsigned ds = height * stride;
+    ret = (libraw_processed_image_t *)::malloc(
+        sizeof(libraw_processed_image_t) + ds);
+    if (!ret)
+    {
+      if (errcode)
+        *errcode = ENOMEM;
+      return NULL;
+    }
+    memset(ret, 0, sizeof(libraw_processed_image_t));
+    ret->type = LIBRAW_IMAGE_BITMAP;
+    ret->height = height;
+    ret->width = width;
+    ret->colors = 3;
+    ret->bits = O.output_bps;
+    ret->data_size = ds;
+
+    // half-size linear buffer is only needed when some pass has to wait for
+    // the whole frame: data maximum or auto-brightness histogram
+    if (!fused || auto_bright)
+      half = (ushort(*)[4])malloc(size_t(ih) * iw * sizeof(*half));
+    size_t hist_size = sizeof(int) * 3 * LIBRAW_HISTOGRAM_SIZE;
+    buffers = malloc_omp_buffers(buffer_count, hist_size + iw * sizeof(*half));
+    for (int i = 0; i < buffer_count; i++)
+      memset(buffers[i], 0, hist_size);
+
+    ushort dmax = 0;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(dynamic) default(none) shared(dmax, half, ret) firstprivate(buffers, cblk, scale_mul, out_cam, ih, iw, fused, auto_bright, hist_size)
+#endif
+    for (int hrow = 0; hrow < ih; hrow++)
+    {
+#ifdef LIBRAW_USE_OPENMP
+      char *buffer = buffers[omp_get_thread_num()];
+#else
+      char *buffer = buffers[0];
+#endif
+      ushort(*quad)[4] =
+          half ? half + size_t(hrow) * iw : (ushort(*)[4])(buffer + hist_size);
+      ushort ldmax = 0;
+      half_image_gather(hrow, quad, cblk, &ldmax);
+      if (fused)
+      {
+        half_image_render(quad, iw, scale_mul, out_cam,
+                          (int(*)[LIBRAW_HISTOGRAM_SIZE])buffer);
+        if (!auto_bright)
+          half_image_emit(quad, hrow, ret);
+      }
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp critical(dataupdate)
+#endif
+      {
+        if (dmax < ldmax)
+          dmax = ldmax;
+      }
+    }
+
+    if (!fused)
+    {
+      C.data_maximum = dmax;
+      adjust_maximum();
+      scale_colors_mul(scale_mul);
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(dynamic) default(none) shared(half, ret) firstprivate(buffers, scale_mul, out_cam, ih, iw, auto_bright)
+#endif
+      for (int hrow = 0; hrow < ih; hrow++)
+      {
+#ifdef LIBRAW_USE_OPENMP
+        char *buffer = buffers[omp_get_thread_num()];
+#else
+        char *buffer = buffers[0];
+#endif
+        half_image_render(half + size_t(hrow) * iw, iw, scale_mul, out_cam,
+                          (int(*)[LIBRAW_HISTOGRAM_SIZE])buffer);
+        if (!auto_bright)
+          half_image_emit(half + size_t(hrow) * iw, hrow, ret);
+      }
+    }
+
+    if (auto_bright)
+    {
+      int *sum = (int *)buffers[0];
+      for (int i = 1; i < buffer_count; i++)
+      {
+        int *h = (int *)buffers[i];
+        for (int k = 0; k < 3 * LIBRAW_HISTOGRAM_SIZE; k++)
+          sum[k] += h[k];
+      }
+      int(*hist)[LIBRAW_HISTOGRAM_SIZE] = (int(*)[LIBRAW_HISTOGRAM_SIZE])sum;
+      int perc, val, total, t_white = 0;
+      perc = iw * ih * O.auto_bright_thr;
+      for (c = 0; c < 3; c++)
+      {
+        for (val = 0x2000, total = 0; --val > 32;)
+          if ((total += hist[c][val]) > perc)
+            break;
+        if (t_white < val)
+          t_white = val;
+      }
+      gamma_curve(O.gamm[0], O.gamm[1], 2, (t_white << 3) / O.bright);
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(none) shared(half, ret) firstprivate(ih, iw)
+#endif
+      for (int hrow = 0; hrow < ih; hrow++)
+        half_image_emit(half + size_t(hrow) * iw, hrow, ret);
+    }
+
+    free_omp_buffers(buffers, buffer_count);
+    if (half)
+      free(half);
+    // imgdata.image (if any) no longer matches color/sizes state
+    imgdata.progress_flags =
+        LIBRAW_PROGRESS_START | LIBRAW_PROGRESS_OPEN |
+        LIBRAW_PROGRESS_RAW2_IMAGE | LIBRAW_PROGRESS_IDENTIFY |
+        LIBRAW_PROGRESS_SIZE_ADJUST | LIBRAW_PROGRESS_LOAD_RAW;
+    if (errcode)
+      *errcode = 0;
+    return ret;
+  }
+  catch (const std::bad_alloc&)
+  {
+    rc = LIBRAW_UNSUFFICIENT_MEMORY;
+  }
+  catch (const LibRaw_exceptions& err)
+  {
+    rc = err == LIBRAW_EXCEPTION_MEMPOOL ? LIBRAW_MEMPOOL_OVERFLOW
+                                         : LIBRAW_UNSUFFICIENT_MEMORY;
+  }
+  if (buffers)
+    free_omp_buffers(buffers, buffer_count);
+  if (half)
+    free(half);
+  ::free(ret);
+  if (errcode)
+    *errcode = rc;
+  return NULL;
+}
+
+// Averages one row of factor x factor blocks; sum[][] holds per-block colour
+// sums followed by pixel counts
+void LibRaw::raw_bin_row(int brow, int factor, INT64 (*sum)[6],
+                         libraw_processed_image_t *img)
+{
+  int bw = img->width;
+  int rows = MIN(int(S.height), int(S.raw_height) - int(S.top_margin));
+  int cols = MIN(bw * factor, int(S.raw_width) - int(S.left_margin));
+  int period = imgdata.idata.filters == 9 ? 6 : 2;
+  int maximum = C.maximum;
+
+  memset(sum, 0, bw * sizeof(*sum));
+  for (int row = brow * factor; row < (brow + 1) * factor && row < rows; row++)
+  {
+    ushort *raw = imgdata.rawdata.raw_image +
+                  (row + S.top_margin) * S.raw_pitch / 2 + S.left_margin;
+    unsigned *pattern = 0;
+    if (C.cblack[4] && C.cblack[5])
+      pattern = C.cblack + 6 + row % C.cblack[4] * C.cblack[5];
+    int fc[6], blk[6];
+    for (int i = 0; i < period; i++)
+    {
+      int c = fcol(row, i);
+      blk[i] = C.cblack[c];
+      fc[i] = c == 3 ? 1 : c; // second Bayer green
+    }
+    if (period == 2 && !pattern)
+    {
+      // Bayer fast path: two interleaved lanes per block, vectorizable
+      for (int col = 0; col < cols; col += factor)
+      {
+        int end = MIN(col + factor, cols), p = col & 1;
+        int b0 = blk[p], b1 = blk[p ^ 1];
+        unsigned s0 = 0, s1 = 0;
+        int x;
+        for (x = col; x + 1 < end; x += 2)
+        {
+          s0 += MAX(MIN(int(raw[x]), maximum) - b0, 0);
+          s1 += MAX(MIN(int(raw[x + 1]), maximum) - b1, 0);
+        }
+        INT64 *s = sum[col / factor];
+        if (x < end)
+        {
+          s0 += MAX(MIN(int(raw[x]), maximum) - b0, 0);
+          s[fc[p] + 3]++;
+        }
+        s[fc[p]] += s0;
+        s[fc[p ^ 1]] += s1;
+        s[fc[p] + 3] += (x - col) / 2;
+        s[fc[p ^ 1] + 3] += (x - col) / 2;
+      }
+      continue;
+    }
+    for (int col = 0, i = 0; col < cols; col += factor)
+    {
+      INT64 *s = sum[col / factor];
+      for (int x = col; x < col + factor && x < cols; x++)
+      {
+        int val = MIN(int(raw[x]), maximum) - blk[i];
+        if (pattern)
+          val -= pattern[x % C.cblack[5]];
+        s[fc[i]] += MAX(val, 0);
+        s[fc[i] + 3]++;
+        if (++i == period)
+          i = 0;
+      }
+    }
+  }
+
+  float range[3];
+  for (int c = 0; c < 3; c++)
+    range[c] = MAX(maximum - int(C.cblack[c]), 1);
+  // green sums hold both Bayer greens, each less its own black
+  for (int i = 0; period == 2 && i < 4; i++)
+    if (fcol(i >> 1, i & 1) == 3)
+      range[1] = MAX(maximum - (C.cblack[1] + C.cblack[3]) / 2.f, 1.f);
+  for (int bx = 0; bx < bw; bx++)
+  {
+    size_t off = (size_t(brow) * bw + bx) * 3;
+    for (int c = 0; c < 3; c++)
+    {
+      float val = sum[bx][c + 3] ? float(sum[bx][c]) / sum[bx][c + 3] / range[c]
+                                 : 0.f;
+      val = MIN(val, 1.f);
+      if (img->bits == 32)
+        ((float *)img->data)[off + c] = val;
+      else
+        ((ushort *)img->data)[off + c] = ushort(val * 65535.f + 0.5f);
+    }
+  }
+}
+
+libraw_processed_image_t *LibRaw::raw_bin(int factor, int bits, int *errcode)
+{
+  if ((imgdata.progress_flags & LIBRAW_PROGRESS_THUMB_MASK) <
+      LIBRAW_PROGRESS_LOAD_RAW)
+  {
+    if (errcode)
+      *errcode = LIBRAW_OUT_OF_ORDER_CALL;
+    return NULL;
+  }
+  if (!imgdata.rawdata.raw_image || imgdata.rawdata.iparams.colors != 3 ||
+      (imgdata.rawdata.iparams.filters <= 1000 &&
+       imgdata.rawdata.iparams.filters != 9) ||
+      imgdata.rawdata.ioparams.fuji_width)
+  {
+    if (errcode)
+      *errcode = LIBRAW_REQUEST_FOR_NONEXISTENT_IMAGE;
+    return NULL;
+  }
+  if (is_phaseone_compressed())
+  {
+    if (errcode)
+      *errcode = LIBRAW_NOT_IMPLEMENTED;
+    return NULL;
+  }
+  if (factor < 2 || (bits != 16 && bits != 32) ||
+      imgdata.rawdata.sizes.width < factor ||
+      imgdata.rawdata.sizes.height < factor)
+  {
+    if (errcode)
+      *errcode = EINVAL;
+    return NULL;
+  }
+
+  libraw_processed_image_t *ret = NULL;
+  char **buffers = NULL;
+  int rc = 0;
+#ifdef LIBRAW_USE_OPENMP
+  int buffer_count = omp_get_max_threads();
+#else
+  int buffer_count = 1;
+#endif
+
+  try
+  {
+    raw2image_start();
+    adjust_bl();
+
+    int width = S.width / factor, height = S.height / factor;
+    unsigned ds = width * height * 3 * (bits / 8);
+    ret = (libraw_processed_image_t *)::malloc(
+        sizeof(libraw_processed_image_t) + ds);
+    if (!ret)
+    {
+      if (errcode)
+        *errcode = ENOMEM;
+      return NULL;
+    }
+    memset(ret, 0, sizeof(libraw_processed_image_t));
+    ret->type = LIBRAW_IMAGE_BITMAP;
+    ret->height = height;
+    ret->width = width;
+    ret->colors = 3;
+    ret->bits = bits;
+    ret->data_size = ds;
+
+    buffers = malloc_omp_buffers(buffer_count, width * sizeof(INT64) * 6);
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(dynamic) default(none) shared(ret) firstprivate(buffers, factor, height)
+#endif
+    for (int brow = 0; brow < height; brow++)
+    {
+#ifdef LIBRAW_USE_OPENMP
+      char *buffer = buffers[omp_get_thread_num()];
+#else
+      char *buffer = buffers[0];
+#endif
+      raw_bin_row(brow, factor, (INT64(*)[6])buffer, ret);
+    }
+
+    free_omp_buffers(buffers, buffer_count);
+    // imgdata.image (if any) no longer matches color/sizes state
+    imgdata.progress_flags =
+        LIBRAW_PROGRESS_START | LIBRAW_PROGRESS_OPEN |
+        LIBRAW_PROGRESS_RAW2_IMAGE | LIBRAW_PROGRESS_IDENTIFY |
+        LIBRAW_PROGRESS_SIZE_ADJUST | LIBRAW_PROGRESS_LOAD_RAW;
+    if (errcode)
+      *errcode = 0;
+    return ret;
+  }
+  catch (const std::bad_alloc&)
+  {
+    rc = LIBRAW_UNSUFFICIENT_MEMORY;
+  }
+  catch (const LibRaw_exceptions& err)
+  {
+    rc = err == LIBRAW_EXCEPTION_MEMPOOL ? LIBRAW_MEMPOOL_OVERFLOW
+                                         : LIBRAW_UNSUFFICIENT_MEMORY;
+  }
+  if (buffers)
+    free_omp_buffers(buffers, buffer_count);
+  ::free(ret);
+  if (errcode)
+    *errcode = rc;
+  return NULL;
+}
@@ -18,6 +18,40 @@
 
 #include "../../internal/dcraw_defs.h"
 
+/* Optimal 9-element median search on a 3x3 block, as min/max pairs */
+#define PIX_SORT(a, b)                                                         \
+  {                                                                            \
+    int t = MIN(a, b);                                                         \
+    b = MAX(a, b);                                                             \
+    a = t;                                                                     \
+  }
+static inline int median9(const int *r0, const int *r1, const int *r2)
+{
+  int m0 = r0[0], m1 = r0[1], m2 = r0[2], m3 = r1[0], m4 = r1[1], m5 = r1[2],
+      m6 = r2[0], m7 = r2[1], m8 = r2[2];
+  PIX_SORT(m1, m2);
+  PIX_SORT(m4, m5);
+  PIX_SORT(m7, m8);
+  PIX_SORT(m0, m1);
+  PIX_SORT(m3, m4);
+  PIX_SORT(m6, m7);
+  PIX_SORT(m1, m2);
+  PIX_SORT(m4, m5);
+  PIX_SORT(m7, m8);
+  PIX_SORT(m0, m3);
+  PIX_SORT(m5, m8);
+  PIX_SORT(m4, m7);
+  PIX_SORT(m3, m6);
+  PIX_SORT(m1, m4);
+  PIX_SORT(m2, m5);
+  PIX_SORT(m4, m7);
+  PIX_SORT(m4, m2);
+  PIX_SORT(m6, m4);
+  PIX_SORT(m4, m2);
+  return m4;
+}
+#undef PIX_SORT
+
 void LibRaw::hat_transform(float *temp, float *base, int st, int size, int sc)
 {
   int i;
@@ -30,110 +64,51 @@ void LibRaw::hat_transform(float *temp, float *base, int st, int size, int sc)
               base[st * (2 * size - 2 - (i + sc))];
 }
 
-#if !defined(LIBRAW_USE_OPENMP)
-void LibRaw::wavelet_denoise()
+/* hat_transform() of one row, scaled by 0.25 straight into out[] */
+void LibRaw::hat_transform_row(float *out, float *base, int size, int sc)
 {
-  float *fimg = 0, *temp, thold, mul[2], avg, diff;
-  int scale = 1, size, lev, hpass, lpass, row, col, nc, c, i, wlast, blk[2];
-  ushort *window[4];
-  static const float noise[] = {0.8002f, 0.2735f, 0.1202f, 0.0585f,
-                                0.0291f, 0.0152f, 0.0080f, 0.0044f};
-
+  int i;
+  for (i = 0; i < sc; i++)
+    out[i] = (2 * base[i] + base[sc - i] + base[i + sc]) * 0.25;
+  for (; i + sc < size; i++)
+    out[i] = (2 * base[i] + base[i - sc] + base[i + sc]) * 0.25;
+  for (; i < size; i++)
+    out[i] = (2 * base[i] + base[i - sc] + base[2 * size - 2 - (i + sc)]) *
+             0.25;
+}
 
-  while (maximum << scale < 0x10000)
-    scale++;
-  maximum <<= --scale;
-  black <<= scale;
-  FORC4 cblack[c] <<= scale;
-  if ((size = iheight * iwidth) < 0x15550000)
-    fimg = (float *)malloc((size * 3 + iheight + iwidth + 128) * sizeof *fimg);
-  temp = fimg + size * 3;
-  if ((nc = colors) == 3 && filters)
-    nc++;
-  FORC(nc)
-  { /* denoise R,G1,B,G3 individually */
-    for (i = 0; i < size; i++)
-      fimg[i] = 256 * sqrt((double)(image[i][c] << scale));
-    for (hpass = lev = 0; lev < 5; lev++)
-    {
-      lpass = size * ((lev & 1) + 1);
-      for (row = 0; row < iheight; row++)
-      {
-        hat_transform(temp, fimg + hpass + row * iwidth, 1, iwidth, 1 << lev);
-        for (col = 0; col < iwidth; col++)
-          fimg[lpass + row * iwidth + col] = temp[col] * 0.25;
-      }
-      for (col = 0; col < iwidth; col++)
-      {
-        hat_transform(temp, fimg + lpass + col, iwidth, iheight, 1 << lev);
-        for (row = 0; row < iheight; row++)
-          fimg[lpass + row * iwidth + col] = temp[row] * 0.25;
-      }
-      thold = threshold * noise[lev];
-      for (i = 0; i < size; i++)
-      {
-        fimg[hpass + i] -= fimg[lpass + i];
-        if (fimg[hpass + i] < -thold)
-          fimg[hpass + i] += thold;
-        else if (fimg[hpass + i] > thold)
-          fimg[hpass + i] -= thold;
-        else
-          fimg[hpass + i] = 0;
-        if (hpass)
-          fimg[i] += fimg[hpass + i];
-      }
-      hpass = lpass;
-    }
-    for (i = 0; i < size; i++)
-      image[i][c] = CLIP(SQR(fimg[i] + fimg[lpass + i]) / 0x10000);
-  }
-  if (filters && colors == 3)
-  { /* pull G1 and G3 closer together */
-    for (row = 0; row < 2; row++)
-    {
-      mul[row] = 0.125 * pre_mul[FC(row + 1, 0) | 1] / pre_mul[FC(row, 0) | 1];
-      blk[row] = cblack[FC(row, 0) | 1];
-    }
-    for (i = 0; i < 4; i++)
-      window[i] = (ushort *)fimg + width * i;
-    for (wlast = -1, row = 1; row < height - 1; row++)
-    {
-      while (wlast < row + 1)
-      {
-        for (wlast++, i = 0; i < 4; i++)
-          window[(i + 3) & 3] = window[i];
-        for (col = FC(wlast, 1) & 1; col < width; col += 2)
-          window[2][col] = BAYER(wlast, col);
-      }
-      thold = threshold / 512;
-      for (col = (FC(row, 0) & 1) + 1; col < width - 1; col += 2)
-      {
-        avg = (window[0][col - 1] + window[0][col + 1] + window[2][col - 1] +
-               window[2][col + 1] - blk[~row & 1] * 4) *
-                  mul[row & 1] +
-              (window[1][col] + blk[row & 1]) * 0.5;
-        avg = avg < 0 ? 0 : sqrt(avg);
-        diff = sqrt((double)BAYER(row, col)) - avg;
-        if (diff < -thold)
-          diff += thold;
-        else if (diff > thold)
-          diff -= thold;
-        else
-          diff = 0;
-        BAYER(row, col) = CLIP(SQR(avg + diff) + 0.5);
-      }
-    }
+/*
+   hat_transform() down a strip of cols columns, in place and scaled by 0.25,
+   a row at a time. Rows already overwritten are still needed up to sc rows
+   back, so their old values are kept in ring[sc][cols]. Needs size >= 2*sc.
+ */
+void LibRaw::hat_transform_cols(float *base, int st, int size, int sc,
+                                int cols, float *ring)
+{
+  float *lo, *hi, *cur, *temp = ring + sc * cols;
+  int i, j, l, h;
+  for (i = 0; i < size; i++)
+  {
+    l = i < sc ? sc - i : i - sc;
+    h = i + sc < size ? i + sc : 2 * size - 2 - (i + sc);
+    cur = base + i * st;
+    lo = l < i ? ring + (l % sc) * cols : base + l * st;
+    hi = h < i ? ring + (h % sc) * cols : base + h * st;
+    for (j = 0; j < cols; j++)
+      temp[j] = 2 * cur[j] + lo[j] + hi[j];
+    memcpy(ring + (i % sc) * cols, cur, cols * sizeof *cur);
+    for (j = 0; j < cols; j++)
+      cur[j] = temp[j] * 0.25;
   }
-  free(fimg);
 }
-#else /* LIBRAW_USE_OPENMP */
+
 void LibRaw::wavelet_denoise()
 {
-  float *fimg = 0, *temp, thold, mul[2], avg, diff;
-  int scale = 1, size, lev, hpass, lpass, row, col, nc, c, i, wlast, blk[2];
-  ushort *window[4];
-  static const float noise[] = {0.8002, 0.2735, 0.1202, 0.0585,
-                                0.0291, 0.0152, 0.0080, 0.0044};
+  float *fimg = 0, *temp, thold, mul[2];
+  int scale = 1, size, lev, hpass, lpass, row, col, nc, c, i, blk[2];
+  ushort *orig;
+  static const float noise[] = {0.8002f, 0.2735f, 0.1202f, 0.0585f,
+                                0.0291f, 0.0152f, 0.0080f, 0.0044f};
 
   while (maximum << scale < 0x10000)
     scale++;
@@ -141,62 +116,76 @@ void LibRaw::wavelet_denoise()
   black <<= scale;
   FORC4 cblack[c] <<= scale;
   if ((size = iheight * iwidth) < 0x15550000)
-    fimg = (float *)malloc((size * 3 + iheight + iwidth) * sizeof *fimg);
-  temp = fimg + size * 3;
+    fimg = (float *)malloc((size * 3 + iheight + iwidth + 128) * sizeof *fimg);
   if ((nc = colors) == 3 && filters)
     nc++;
+#ifdef LIBRAW_USE_OPENMP
 #pragma omp parallel default(shared) private(                                  \
     i, col, row, thold, lev, lpass, hpass, temp, c) firstprivate(scale, size)
+#endif
   {
-    temp = (float *)malloc((iheight + iwidth) * sizeof *fimg);
+    temp = (float *)malloc(
+        MAX(iheight + iwidth, 17 * LIBRAW_WAVELET_STRIP) * sizeof *fimg);
     FORC(nc)
     { /* denoise R,G1,B,G3 individually */
+#ifdef LIBRAW_USE_OPENMP
 #pragma omp for
+#endif
       for (i = 0; i < size; i++)
         fimg[i] = 256 * sqrt((double)(image[i][c] << scale));
       for (hpass = lev = 0; lev < 5; lev++)
       {
         lpass = size * ((lev & 1) + 1);
+#ifdef LIBRAW_USE_OPENMP
 #pragma omp for
+#endif
         for (row = 0; row < iheight; row++)
+          hat_transform_row(fimg + lpass + row * iwidth,
+                            fimg + hpass + row * iwidth, iwidth, 1 << lev);
+        if (iheight >= 2 << lev)
         {
-          hat_transform(temp, fimg + hpass + row * iwidth, 1, iwidth, 1 << lev);
-          for (col = 0; col < iwidth; col++)
-            fimg[lpass + row * iwidth + col] = temp[col] * 0.25;
-        }
+#ifdef LIBRAW_USE_OPENMP
 #pragma omp for
-        for (col = 0; col < iwidth; col++)
+#endif
+          for (col = 0; col < iwidth; col += LIBRAW_WAVELET_STRIP)
+            hat_transform_cols(fimg + lpass + col, iwidth, iheight, 1 << lev,
+                               MIN(LIBRAW_WAVELET_STRIP, iwidth - col), temp);
+        }
+        else
         {
-          hat_transform(temp, fimg + lpass + col, iwidth, iheight, 1 << lev);
-          for (row = 0; row < iheight; row++)
-            fimg[lpass + row * iwidth + col] = temp[row] * 0.25;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp for
+#endif
+          for (col = 0; col < iwidth; col++)
+          {
+            hat_transform(temp, fimg + lpass + col, iwidth, iheight, 1 << lev);
+            for (row = 0; row < iheight; row++)
+              fimg[lpass + row * iwidth + col] = temp[row] * 0.25;
+          }
         }
         thold = threshold * noise[lev];
+#ifdef LIBRAW_USE_OPENMP
 #pragma omp for
+#endif
         for (i = 0; i < size; i++)
         {
-          fimg[hpass + i] -= fimg[lpass + i];
-          if (fimg[hpass + i] < -thold)
-            fimg[hpass + i] += thold;
-          else if (fimg[hpass + i] > thold)
-            fimg[hpass + i] -= thold;
-          else
-            fimg[hpass + i] = 0;
+          /* soft threshold, both sides computed so the loop vectorizes */
+          float d = fimg[hpass + i] - fimg[lpass + i];
+          float dn = d - thold, dp = d + thold;
+          fimg[hpass + i] = (dn > 0 ? dn : 0) + (dp < 0 ? dp : 0);
           if (hpass)
             fimg[i] += fimg[hpass + i];
         }
         hpass = lpass;
       }
+#ifdef LIBRAW_USE_OPENMP
 #pragma omp for
+#endif
       for (i = 0; i < size; i++)
         image[i][c] = CLIP(SQR(fimg[i] + fimg[lpass + i]) / 0x10000);
     }
     free(temp);
   } /* end omp parallel */
-  /* the following loops are hard to parallelize, no idea yes,
-   * problem is wlast which is carrying dependency
-   * second part should be easier, but did not yet get it right.
-   */
   if (filters && colors == 3)
   { /* pull G1 and G3 closer together */
     for (row = 0; row < 2; row++)
@@ -204,26 +193,30 @@ void LibRaw::wavelet_denoise()
       mul[row] = 0.125 * pre_mul[FC(row + 1, 0) | 1] / pre_mul[FC(row, 0) | 1];
       blk[row] = cblack[FC(row, 0) | 1];
     }
-    for (i = 0; i < 4; i++)
-      window[i] = (ushort *)fimg + width * i;
-    for (wlast = -1, row = 1; row < height - 1; row++)
+    /* green values as they were before this pass, so rows go in any order */
+    orig = (ushort *)fimg;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for default(shared) private(col)
+#endif
+    for (row = 0; row < height; row++)
+      for (col = FC(row, 1) & 1; col < width; col += 2)
+        orig[row * width + col] = BAYER(row, col);
+    thold = threshold / 512;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for default(shared) private(col)
+#endif
+    for (row = 1; row < height - 1; row++)
     {
-      while (wlast < row + 1)
-      {
-        for (wlast++, i = 0; i < 4; i++)
-          window[(i + 3) & 3] = window[i];
-        for (col = FC(wlast, 1) & 1; col < width; col += 2)
-          window[2][col] = BAYER(wlast, col);
-      }
-      thold = threshold / 512;
+      ushort *above = orig + (row - 1) * width, *cur = orig + row * width,
+             *below = orig + (row + 1) * width;
       for (col = (FC(row, 0) & 1) + 1; col < width - 1; col += 2)
       {
-        avg = (window[0][col - 1] + window[0][col + 1] + window[2][col - 1] +
-               window[2][col + 1] - blk[~row & 1] * 4) *
-                  mul[row & 1] +
-              (window[1][col] + blk[row & 1]) * 0.5;
+        float avg = (above[col - 1] + above[col + 1] + below[col - 1] +
+                     below[col + 1] - blk[~row & 1] * 4) *
+                        mul[row & 1] +
+                    (cur[col] + blk[row & 1]) * 0.5;
         avg = avg < 0 ? 0 : sqrt(avg);
-        diff = sqrt((double)BAYER(row, col)) - avg;
+        float diff = sqrt((double)cur[col]) - avg;
         if (diff < -thold)
           diff += thold;
         else if (diff > thold)
@@ -237,36 +230,50 @@ void LibRaw::wavelet_denoise()
   free(fimg);
 }
 
-#endif
 void LibRaw::median_filter()
 {
-  ushort(*pix)[4];
-  int pass, c, i, j, k, med[9];
-  static const uchar opt[] = /* Optimal 9-element median search */
-      {1, 2, 4, 5, 7, 8, 0, 1, 3, 4, 6, 7, 1, 2, 4, 5, 7, 8, 0,
-       3, 5, 8, 4, 7, 3, 6, 1, 4, 2, 5, 4, 7, 4, 2, 6, 4, 4, 2};
+  int pass, c, i, row, col;
+#ifdef LIBRAW_USE_OPENMP
+  int buffer_count = omp_get_max_threads();
+#else
+  int buffer_count = 1;
+#endif
+  char **buffers = malloc_omp_buffers(buffer_count, 4 * width * sizeof(int));
 
   for (pass = 1; pass <= med_passes; pass++)
   {
     RUN_CALLBACK(LIBRAW_PROGRESS_MEDIAN_FILTER, pass - 1, med_passes);
     for (c = 0; c < 3; c += 2)
     {
-      for (pix = image; pix < image + width * height; pix++)
-        pix[0][3] = pix[0][c];
-      for (pix = image + width; pix < image + width * (height - 1); pix++)
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared)
+#endif
+      for (i = 0; i < width * height; i++)
+        image[i][3] = image[i][c];
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(col)
+#endif
+      for (row = 1; row < height - 1; row++)
       {
-        if ((pix - image + 1) % width < 2)
-          continue;
-        for (k = 0, i = -width; i <= width; i += width)
-          for (j = i - 1; j <= i + 1; j++)
-            med[k++] = pix[j][3] - pix[j][1];
-        for (i = 0; i < int(sizeof opt); i += 2)
-          if (med[opt[i]] > med[opt[i + 1]])
-            SWAP(med[opt[i]], med[opt[i + 1]]);
-        pix[0][c] = CLIP(med[4] + pix[0][1]);
+#ifdef LIBRAW_USE_OPENMP
+        int *diff = (int *)buffers[omp_get_thread_num()];
+#else
+        int *diff = (int *)buffers[0];
+#endif
+        int *med = diff + 3 * width;
+        ushort(*pix)[4] = image + (row - 1) * width;
+        for (col = 0; col < 3 * width; col++)
+          diff[col] = pix[col][3] - pix[col][1];
+        for (col = 1; col < width - 1; col++)
+          med[col] = median9(diff + col - 1, diff + width + col - 1,
+                             diff + 2 * width + col - 1);
+        pix += width;
+        for (col = 1; col < width - 1; col++)
+          pix[col][c] = CLIP(med[col] + pix[col][1]);
       }
     }
   }
+  free_omp_buffers(buffers, buffer_count);
 }
 
 void LibRaw::blend_highlights()
@@ -284,6 +291,10 @@ void LibRaw::blend_highlights()
     return;
   RUN_CALLBACK(LIBRAW_PROGRESS_HIGHLIGHTS, 0, 2);
   FORCC if (clip > (i = 65535 * pre_mul[c])) clip = i;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(dynamic) default(shared) private(            \
+    col, c, i, j, cam, lab, sum, chratio)
+#endif
   for (row = 0; row < height; row++)
     for (col = 0; col < width; col++)
     {
@@ -334,6 +345,10 @@ void LibRaw::recover_highlights()
   {
     RUN_CALLBACK(LIBRAW_PROGRESS_HIGHLIGHTS, c - 1, colors - 1);
     memset(map, 0, high * wide * sizeof *map);
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(dynamic) default(shared) private(            \
+    mcol, sum, wgt, count, row, col, pixel)
+#endif
     for (mrow = 0; mrow < high; mrow++)
       for (mcol = 0; mcol < wide; mcol++)
       {
@@ -354,6 +369,12 @@ void LibRaw::recover_highlights()
       }
     for (spread = 32 / grow; spread--;)
     {
+      /* new values are stored negated and only positive ones are read, so
+         rows of one sweep are independent */
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(            \
+    mcol, sum, count, d, y, x)
+#endif
       for (mrow = 0; mrow < high; mrow++)
         for (mcol = 0; mcol < wide; mcol++)
         {
@@ -373,7 +394,11 @@ void LibRaw::recover_highlights()
           if (count > 3)
             map[mrow * wide + mcol] = -(sum + grow) / (count + grow);
         }
-      for (change = i = 0; i < int(high * wide); i++)
+      change = 0;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) reduction(| : change)
+#endif
+      for (i = 0; i < int(high * wide); i++)
         if (map[i] < 0)
         {
           map[i] = -map[i];
@@ -385,6 +410,10 @@ void LibRaw::recover_highlights()
     for (i = 0; i < int(high * wide); i++)
       if (map[i] == 0)
         map[i] = 1;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(dynamic) default(shared) private(            \
+    mcol, row, col, pixel, val)
+#endif
     for (mrow = 0; mrow < high; mrow++)
       for (mcol = 0; mcol < wide; mcol++)
       {
@@ -27,5 +27,7 @@ libraw_processed_image_t *LibRaw::dcraw_make_mem_image(int *) {
   return NULL;
 }
 libraw_processed_image_t *LibRaw::dcraw_make_mem_thumb(int *){ return NULL;}
+libraw_processed_image_t *LibRaw::dcraw_make_half_image(int *){ return NULL;}
+libraw_processed_image_t *LibRaw::raw_bin(int, int, int *){ return NULL;}
 void LibRaw::lin_interpolate_loop(int * /*code*/, int /*size*/) {}
 void LibRaw::scale_colors_loop(float /*scale_mul*/[4]) {}
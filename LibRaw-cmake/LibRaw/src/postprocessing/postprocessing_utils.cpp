@@ -78,113 +78,120 @@ void LibRaw::exp_bef(float shift, float smooth)
 
 void LibRaw::convert_to_rgb_loop(float out_cam[3][4])
 {
-  int row, col, c;
-  float out[3];
-  ushort *img;
-  memset(libraw_internal_data.output_data.histogram, 0,
-         sizeof(int) * LIBRAW_HISTOGRAM_SIZE * 4);
-  if (libraw_internal_data.internal_output_params.raw_color)
+  int colors = imgdata.idata.colors;
+  int raw_color = libraw_internal_data.internal_output_params.raw_color;
+  size_t hist_size = sizeof(int) * LIBRAW_HISTOGRAM_SIZE * 4;
+#ifdef LIBRAW_USE_OPENMP
+  int buffer_count = omp_get_max_threads();
+#else
+  int buffer_count = 1;
+#endif
+  char **buffers = malloc_omp_buffers(buffer_count, hist_size);
+  for (int i = 0; i < buffer_count; i++)
+    memset(buffers[i], 0, hist_size);
+
+  // Rows are independent; each thread counts into its own histogram
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(none) firstprivate(buffers, out_cam, colors, raw_color)
+#endif
+  for (int row = 0; row < S.height; row++)
   {
-    for (img = imgdata.image[0], row = 0; row < S.height; row++)
+#ifdef LIBRAW_USE_OPENMP
+    int(*hist)[LIBRAW_HISTOGRAM_SIZE] =
+        (int(*)[LIBRAW_HISTOGRAM_SIZE])buffers[omp_get_thread_num()];
+#else
+    int(*hist)[LIBRAW_HISTOGRAM_SIZE] =
+        (int(*)[LIBRAW_HISTOGRAM_SIZE])buffers[0];
+#endif
+    ushort(*img)[4] = imgdata.image + size_t(row) * S.width;
+    int col, c;
+    if (raw_color)
     {
-      for (col = 0; col < S.width; col++, img += 4)
-      {
-        for (c = 0; c < imgdata.idata.colors; c++)
-        {
-          libraw_internal_data.output_data.histogram[c][img[c] >> 3]++;
-        }
-      }
+      for (col = 0; col < S.width; col++)
+        for (c = 0; c < colors; c++)
+          hist[c][img[col][c] >> 3]++;
     }
-  }
-  else if (imgdata.idata.colors == 3)
-  {
-    for (img = imgdata.image[0], row = 0; row < S.height; row++)
+    else if (colors == 3)
     {
-      for (col = 0; col < S.width; col++, img += 4)
+      for (col = 0; col < S.width; col++)
       {
-        out[0] = out_cam[0][0] * img[0] + out_cam[0][1] * img[1] +
-                 out_cam[0][2] * img[2];
-        out[1] = out_cam[1][0] * img[0] + out_cam[1][1] * img[1] +
-                 out_cam[1][2] * img[2];
-        out[2] = out_cam[2][0] * img[0] + out_cam[2][1] * img[1] +
-                 out_cam[2][2] * img[2];
-        img[0] = CLIP((int)out[0]);
-        img[1] = CLIP((int)out[1]);
-        img[2] = CLIP((int)out[2]);
-        libraw_internal_data.output_data.histogram[0][img[0] >> 3]++;
-        libraw_internal_data.output_data.histogram[1][img[1] >> 3]++;
-        libraw_internal_data.output_data.histogram[2][img[2] >> 3]++;
+        float out[3];
+        for (c = 0; c < 3; c++)
+          out[c] = out_cam[c][0] * img[col][0] + out_cam[c][1] * img[col][1] +
+                   out_cam[c][2] * img[col][2];
+        for (c = 0; c < 3; c++)
+          img[col][c] = CLIP((int)out[c]);
       }
+      for (col = 0; col < S.width; col++)
+        for (c = 0; c < 3; c++)
+          hist[c][img[col][c] >> 3]++;
     }
-  }
-  else if (imgdata.idata.colors == 4)
-  {
-    for (img = imgdata.image[0], row = 0; row < S.height; row++)
+    else if (colors == 4)
     {
-      for (col = 0; col < S.width; col++, img += 4)
+      for (col = 0; col < S.width; col++)
       {
-        out[0] = out_cam[0][0] * img[0] + out_cam[0][1] * img[1] +
-                 out_cam[0][2] * img[2] + out_cam[0][3] * img[3];
-        out[1] = out_cam[1][0] * img[0] + out_cam[1][1] * img[1] +
-                 out_cam[1][2] * img[2] + out_cam[1][3] * img[3];
-        out[2] = out_cam[2][0] * img[0] + out_cam[2][1] * img[1] +
-                 out_cam[2][2] * img[2] + out_cam[2][3] * img[3];
-        img[0] = CLIP((int)out[0]);
-        img[1] = CLIP((int)out[1]);
-        img[2] = CLIP((int)out[2]);
-        libraw_internal_data.output_data.histogram[0][img[0] >> 3]++;
-        libraw_internal_data.output_data.histogram[1][img[1] >> 3]++;
-        libraw_internal_data.output_data.histogram[2][img[2] >> 3]++;
-        libraw_internal_data.output_data.histogram[3][img[3] >> 3]++;
+        float out[3];
+        for (c = 0; c < 3; c++)
+          out[c] = out_cam[c][0] * img[col][0] + out_cam[c][1] * img[col][1] +
+                   out_cam[c][2] * img[col][2] + out_cam[c][3] * img[col][3];
+        for (c = 0; c < 3; c++)
+          img[col][c] = CLIP((int)out[c]);
       }
+      for (col = 0; col < S.width; col++)
+        for (c = 0; c < 4; c++)
+          hist[c][img[col][c] >> 3]++;
     }
   }
+
+  int *sum = (int *)libraw_internal_data.output_data.histogram;
+  memcpy(sum, buffers[0], hist_size);
+  for (int i = 1; i < buffer_count; i++)
+  {
+    int *h = (int *)buffers[i];
+    for (int k = 0; k < LIBRAW_HISTOGRAM_SIZE * 4; k++)
+      sum[k] += h[k];
+  }
+  free_omp_buffers(buffers, buffer_count);
 }
 
 void LibRaw::scale_colors_loop(float scale_mul[4])
 {
-  unsigned size = S.iheight * S.iwidth;
+  int pattern = C.cblack[4] && C.cblack[5];
+  int cblk[4];
+  for (int c = 0; c < 4; c++)
+    cblk[c] = C.cblack[c];
 
-  if (C.cblack[4] && C.cblack[5])
-  {
-    int val;
-    for (unsigned i = 0; i < size; i++)
-    {
-      for (unsigned c = 0; c < 4; c++)
-      {
-        if (!(val = imgdata.image[i][c])) continue;
-        val -= C.cblack[6 + i / S.iwidth % C.cblack[4] * C.cblack[5] +
-                        i % S.iwidth % C.cblack[5]];
-        val -= C.cblack[c];
-        val *= scale_mul[c];
-        imgdata.image[i][c] = CLIP(val);
-      }
-    }
-  }
-  else if (C.cblack[0] || C.cblack[1] || C.cblack[2] || C.cblack[3])
+  // A zero pixel stays zero with or without the early-out the scalar
+  // version had, so every row is one branch-free, vectorizable loop
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(none) firstprivate(scale_mul, cblk, pattern)
+#endif
+  for (int row = 0; row < S.iheight; row++)
   {
-    for (unsigned i = 0; i < size; i++)
+    ushort(*img)[4] = imgdata.image + size_t(row) * S.iwidth;
+    if (pattern)
     {
-      for (unsigned c = 0; c < 4; c++)
+      const unsigned *pblk = C.cblack + 6 + row % C.cblack[4] * C.cblack[5];
+      for (int col = 0; col < S.iwidth; col++)
       {
-        int val = imgdata.image[i][c];
-        if (!val) continue;
-        val -= C.cblack[c];
-        val *= scale_mul[c];
-        imgdata.image[i][c] = CLIP(val);
+        int pb = pblk[col % C.cblack[5]];
+        for (int c = 0; c < 4; c++)
+        {
+          int val = img[col][c] - pb - cblk[c];
+          val *= scale_mul[c];
+          img[col][c] = CLIP(val);
+        }
       }
     }
-  }
-  else // BL is zero
-  {
-    for (unsigned i = 0; i < size; i++)
+    else
     {
-      for (unsigned c = 0; c < 4; c++)
-      {
-        int val = imgdata.image[i][c];
-        val *= scale_mul[c];
-        imgdata.image[i][c] = CLIP(val);
-      }
+      for (int col = 0; col < S.iwidth; col++)
+        for (int c = 0; c < 4; c++)
+        {
+          int val = img[col][c] - cblk[c];
+          val *= scale_mul[c];
+          img[col][c] = CLIP(val);
+        }
     }
   }
 }
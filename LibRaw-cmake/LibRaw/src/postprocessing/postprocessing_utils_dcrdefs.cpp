@@ -18,15 +18,28 @@
 
 #include "../../internal/dcraw_defs.h"
 
+static const double(*out_rgb[])[3] = {
+    LibRaw_constants::rgb_rgb,  LibRaw_constants::adobe_rgb,
+    LibRaw_constants::wide_rgb, LibRaw_constants::prophoto_rgb,
+    LibRaw_constants::xyz_rgb,  LibRaw_constants::aces_rgb,
+    LibRaw_constants::dcip3d65_rgb,  LibRaw_constants::rec2020_rgb};
+
+void LibRaw::convert_to_rgb_matrix(float out_cam[3][4])
+{
+  int i, j, k;
+  memcpy(out_cam, rgb_cam, sizeof rgb_cam);
+  raw_color |= colors == 1 || output_color < 1 || output_color > 8;
+  if (!raw_color)
+    for (i = 0; i < 3; i++)
+      for (j = 0; j < colors; j++)
+        for (out_cam[i][j] = k = 0; k < 3; k++)
+          out_cam[i][j] += out_rgb[output_color - 1][i][k] * rgb_cam[k][j];
+}
+
 void LibRaw::convert_to_rgb()
 {
   float out_cam[3][4];
   double num, inverse[3][3];
-  static const double(*out_rgb[])[3] = {
-      LibRaw_constants::rgb_rgb,  LibRaw_constants::adobe_rgb,
-      LibRaw_constants::wide_rgb, LibRaw_constants::prophoto_rgb,
-      LibRaw_constants::xyz_rgb,  LibRaw_constants::aces_rgb,
-      LibRaw_constants::dcip3d65_rgb,  LibRaw_constants::rec2020_rgb};
   static const char *name[] = {"sRGB",          "Adobe RGB (1998)",
                                "WideGamut D65", "ProPhoto D65",
                                "XYZ",           "ACES",
@@ -51,7 +64,6 @@ void LibRaw::convert_to_rgb()
   RUN_CALLBACK(LIBRAW_PROGRESS_CONVERT_RGB, 0, 2);
 
   gamma_curve(gamm[0], gamm[1], 0, 0);
-  memcpy(out_cam, rgb_cam, sizeof out_cam);
   raw_color |= colors == 1 || output_color < 1 || output_color > 8;
   if (!raw_color)
   {
@@ -95,11 +107,8 @@ void LibRaw::convert_to_rgb()
     strcpy((char *)oprof + pbody[2] + 8, "auto-generated by dcraw");
     if (pbody[5] + 12 + prof_desc.size() < phead[0])
 		strcpy((char *)oprof + pbody[5] + 12, prof_desc.data());
-    for (i = 0; i < 3; i++)
-      for (j = 0; j < colors; j++)
-        for (out_cam[i][j] = k = 0; k < 3; k++)
-          out_cam[i][j] += out_rgb[output_color - 1][i][k] * rgb_cam[k][j];
   }
+  convert_to_rgb_matrix(out_cam);
   convert_to_rgb_loop(out_cam);
 
   if (colors == 4 && output_color)
@@ -108,56 +117,11 @@ void LibRaw::convert_to_rgb()
   RUN_CALLBACK(LIBRAW_PROGRESS_CONVERT_RGB, 1, 2);
 }
 
-void LibRaw::scale_colors()
+void LibRaw::scale_colors_wb()
 {
-  unsigned bottom, right, size, row, col, ur, uc, i, x, y, c, sum[8];
+  unsigned row, col, c, sum[8];
   int val;
-  double dsum[8], dmin, dmax;
-  float scale_mul[4], fr, fc;
-  ushort *img = 0, *pix;
-
-  RUN_CALLBACK(LIBRAW_PROGRESS_SCALE_COLORS, 0, 2);
 
-  if (user_mul[0])
-    memcpy(pre_mul, user_mul, sizeof pre_mul);
-  if (use_auto_wb || (use_camera_wb && 
-      (cam_mul[0] < -0.5  // LibRaw 0.19 and older: fallback to auto only if cam_mul[0] is set to -1
-          || (cam_mul[0] <= 0.00001f  // New default: fallback to auto if no cam_mul parsed from metadata
-              && !(imgdata.rawparams.options & LIBRAW_RAWOPTIONS_CAMERAWB_FALLBACK_TO_DAYLIGHT))
-          )))
-  {
-    memset(dsum, 0, sizeof dsum);
-    bottom = MIN(greybox[1] + greybox[3], height);
-    right = MIN(greybox[0] + greybox[2], width);
-    for (row = greybox[1]; row < bottom; row += 8)
-      for (col = greybox[0]; col < right; col += 8)
-      {
-        memset(sum, 0, sizeof sum);
-        for (y = row; y < row + 8 && y < bottom; y++)
-          for (x = col; x < col + 8 && x < right; x++)
-            FORC4
-            {
-              if (filters)
-              {
-                c = fcol(y, x);
-                val = BAYER2(y, x);
-              }
-              else
-                val = image[y * width + x][c];
-              if (val > (int)maximum - 25)
-                goto skip_block;
-              if ((val -= cblack[c]) < 0)
-                val = 0;
-              sum[c] += val;
-              sum[c + 4]++;
-              if (filters)
-                break;
-            }
-        FORC(8) dsum[c] += sum[c];
-      skip_block:;
-      }
-    FORC4 if (dsum[c]) pre_mul[c] = dsum[c + 4] / dsum[c];
-  }
   if (use_camera_wb && cam_mul[0] > 0.00001f)
   {
     memset(sum, 0, sizeof sum);
@@ -194,9 +158,13 @@ void LibRaw::scale_colors()
     pre_mul[1] = 1;
   if (pre_mul[3] == 0)
     pre_mul[3] = colors < 4 ? pre_mul[1] : 1;
-  if (threshold)
-    wavelet_denoise();
-  maximum -= black;
+}
+
+void LibRaw::scale_colors_mul(float scale_mul[4])
+{
+  double dmin, dmax;
+  unsigned c;
+
   for (dmin = DBL_MAX, dmax = c = 0; c < 4; c++)
   {
     if (dmin > pre_mul[c])
@@ -210,6 +178,63 @@ void LibRaw::scale_colors()
     FORC4 scale_mul[c] = (pre_mul[c] /= dmax) * 65535.0 / maximum;
   else
     FORC4 scale_mul[c] = 1.0;
+}
+
+void LibRaw::scale_colors()
+{
+  unsigned bottom, right, size, row, col, ur, uc, i, x, y, c, sum[8];
+  int val;
+  double dsum[8];
+  float scale_mul[4], fr, fc;
+  ushort *img = 0, *pix;
+
+  RUN_CALLBACK(LIBRAW_PROGRESS_SCALE_COLORS, 0, 2);
+
+  if (user_mul[0])
+    memcpy(pre_mul, user_mul, sizeof pre_mul);
+  if (use_auto_wb || (use_camera_wb && 
+      (cam_mul[0] < -0.5  // LibRaw 0.19 and older: fallback to auto only if cam_mul[0] is set to -1
+          || (cam_mul[0] <= 0.00001f  // New default: fallback to auto if no cam_mul parsed from metadata
+              && !(imgdata.rawparams.options & LIBRAW_RAWOPTIONS_CAMERAWB_FALLBACK_TO_DAYLIGHT))
+          )))
+  {
+    memset(dsum, 0, sizeof dsum);
+    bottom = MIN(greybox[1] + greybox[3], height);
+    right = MIN(greybox[0] + greybox[2], width);
+    for (row = greybox[1]; row < bottom; row += 8)
+      for (col = greybox[0]; col < right; col += 8)
+      {
+        memset(sum, 0, sizeof sum);
+        for (y = row; y < row + 8 && y < bottom; y++)
+          for (x = col; x < col + 8 && x < right; x++)
+            FORC4
+            {
+              if (filters)
+              {
+                c = fcol(y, x);
+                val = BAYER2(y, x);
+              }
+              else
+                val = image[y * width + x][c];
+              if (val > (int)maximum - 25)
+                goto skip_block;
+              if ((val -= cblack[c]) < 0)
+                val = 0;
+              sum[c] += val;
+              sum[c + 4]++;
+              if (filters)
+                break;
+            }
+        FORC(8) dsum[c] += sum[c];
+      skip_block:;
+      }
+    FORC4 if (dsum[c]) pre_mul[c] = dsum[c + 4] / dsum[c];
+  }
+  scale_colors_wb();
+  if (threshold)
+    wavelet_denoise();
+  maximum -= black;
+  scale_colors_mul(scale_mul);
 
   if (filters > 1000 && (cblack[4] + 1) / 2 == 1 && (cblack[5] + 1) / 2 == 1)
   {
@@ -265,29 +265,35 @@ void LibRaw::copy_bayer(unsigned short cblack[4], unsigned short *dmaxp)
 {
   // Both cropped and uncropped
   int maxHeight = MIN(int(S.height),int(S.raw_height)-int(S.top_margin));
+  int maxWidth = MIN(int(S.width), int(S.raw_width) - int(S.left_margin));
 #if defined(LIBRAW_USE_OPENMP)
-#pragma omp parallel for schedule(dynamic) default(none) shared(dmaxp) firstprivate(cblack, maxHeight)
+#pragma omp parallel for schedule(dynamic) default(none) shared(dmaxp) firstprivate(cblack, maxHeight, maxWidth)
 #endif
   for (int row = 0; row < maxHeight ; row++)
   {
-    int col;
+    // CFA colors repeat every 2 (Bayer), 6 (X-Trans) or 16 (Leaf) columns
+    const int period = 48;
+    unsigned char cc[period];
+    unsigned short bl[period];
+    int col, k;
     unsigned short ldmax = 0;
-    for (col = 0; col < S.width && col + S.left_margin < S.raw_width; col++)
+    for (k = 0; k < period && k < maxWidth; k++)
     {
-      unsigned short val =
-          imgdata.rawdata.raw_image[(row + S.top_margin) * S.raw_pitch / 2 +
-                                    (col + S.left_margin)];
-      int cc = fcol(row, col);
-      if (val > cblack[cc])
+      cc[k] = fcol(row, k);
+      bl[k] = cblack[cc[k]];
+    }
+    const unsigned short *src =
+        imgdata.rawdata.raw_image +
+        (row + S.top_margin) * S.raw_pitch / 2 + S.left_margin;
+    ushort(*dst)[4] = imgdata.image + ((row) >> IO.shrink) * S.iwidth;
+    for (col = 0; col < maxWidth; col += period)
+      for (k = 0; k < period && col + k < maxWidth; k++)
       {
-        val -= cblack[cc];
-        if (val > ldmax)
-          ldmax = val;
+        unsigned short val = src[col + k];
+        val = val > bl[k] ? val - bl[k] : 0;
+        ldmax = MAX(ldmax, val);
+        dst[(col + k) >> IO.shrink][cc[k]] = val;
       }
-      else
-        val = 0;
-      imgdata.image[((row) >> IO.shrink) * S.iwidth + ((col) >> IO.shrink)][cc] = val;
-    }
 #if defined(LIBRAW_USE_OPENMP)
 #pragma omp critical(dataupdate)
 #endif
@@ -507,6 +513,9 @@ int LibRaw::raw2image_ex(int do_subtract_black)
       else if (imgdata.rawdata.color3_image)
       {
           unsigned char *c3image = (unsigned char *)imgdata.rawdata.color3_image;
+#if defined(LIBRAW_USE_OPENMP)
+#pragma omp parallel for schedule(static) default(shared)
+#endif
           for (int row = 0; row < copyheight; row++)
         {
           ushort(*srcrow)[3] =
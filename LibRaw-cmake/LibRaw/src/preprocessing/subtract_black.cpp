@@ -35,34 +35,46 @@ int LibRaw::subtract_black_internal()
       for (i = 0; i < 4; i++)
         cblk[i] = C.cblack[i];
 
-      int size = S.iheight * S.iwidth;
       int dmax = 0;
+      int row, col, c;
       if (C.cblack[4] && C.cblack[5])
       {
-        for (unsigned q = 0; q < (unsigned)size; q++)
+#if defined(LIBRAW_USE_OPENMP)
+#pragma omp parallel for schedule(static) default(shared) private(col, c) reduction(max : dmax)
+#endif
+        for (row = 0; row < S.iheight; row++)
         {
-          for (unsigned c = 0; c < 4; c++)
+          const unsigned *pat = &C.cblack[6 + row % C.cblack[4] * C.cblack[5]];
+          ushort(*pix)[4] = imgdata.image + row * S.iwidth;
+          unsigned k = 0;
+          for (col = 0; col < S.iwidth; col++)
           {
-            int val = imgdata.image[q][c];
-            val -= C.cblack[6 + q / S.iwidth % C.cblack[4] * C.cblack[5] +
-                            q % S.iwidth % C.cblack[5]];
-            val -= cblk[c];
-            imgdata.image[q][c] = CLIP(val);
-            if (dmax < val) dmax = val;
+            for (c = 0; c < 4; c++)
+            {
+              int val = pix[col][c] - int(pat[k]) - cblk[c];
+              pix[col][c] = CLIP(val);
+              dmax = MAX(dmax, val);
+            }
+            if (++k == C.cblack[5])
+              k = 0;
           }
         }
       }
       else
       {
-        for (unsigned q = 0; q < (unsigned)size; q++)
+#if defined(LIBRAW_USE_OPENMP)
+#pragma omp parallel for schedule(static) default(shared) private(col, c) reduction(max : dmax)
+#endif
+        for (row = 0; row < S.iheight; row++)
         {
-          for (unsigned c = 0; c < 4; c++)
-          {
-            int val = imgdata.image[q][c];
-            val -= cblk[c];
-            imgdata.image[q][c] = CLIP(val);
-            if (dmax < val) dmax = val;
-          }
+          ushort *pix = imgdata.image[row * S.iwidth];
+          for (col = 0; col < S.iwidth * 4; col += 4)
+            for (c = 0; c < 4; c++)
+            {
+              int val = pix[col + c] - cblk[c];
+              pix[col + c] = CLIP(val);
+              dmax = MAX(dmax, val);
+            }
         }
       }
       C.data_maximum = dmax & 0xffff;
@@ -77,6 +89,9 @@ int LibRaw::subtract_black_internal()
       int idx;
       ushort *p = (ushort *)imgdata.image;
       int dmax = 0;
+#if defined(LIBRAW_USE_OPENMP)
+#pragma omp parallel for schedule(static) default(shared) reduction(max : dmax)
+#endif
       for (idx = 0; idx < S.iheight * S.iwidth * 4; idx++)
         if (dmax < p[idx])
           dmax = p[idx];
@@ -69,7 +69,8 @@ int LibRaw::get_decoder_info(libraw_decoder_info_t *d_info)
   {
     d_info->decoder_name = "lossless_jpeg_load_raw()";
     d_info->decoder_flags =
-        LIBRAW_DECODER_HASCURVE | LIBRAW_DECODER_TRYRAWSPEED | LIBRAW_DECODER_TRYRAWSPEED3;
+        LIBRAW_DECODER_HASCURVE | LIBRAW_DECODER_TRYRAWSPEED | LIBRAW_DECODER_TRYRAWSPEED3 |
+        LIBRAW_DECODER_RAWBANDS;
   }
   else if (load_raw == &LibRaw::canon_sraw_load_raw)
   {
@@ -79,6 +80,7 @@ int LibRaw::get_decoder_info(libraw_decoder_info_t *d_info)
   else if (load_raw == &LibRaw::crxLoadRaw)
   {
     d_info->decoder_name = "crxLoadRaw()";
+    d_info->decoder_flags = LIBRAW_DECODER_RAWBANDS | LIBRAW_DECODER_RAWBANDRING;
   }
   else if (load_raw == &LibRaw::lossless_dng_load_raw)
   {
@@ -33,6 +33,7 @@ LibRaw::LibRaw(unsigned int flags) : memmgr(1024)
   unsigned greybox[4] = {0, 0, UINT_MAX, UINT_MAX};
   unsigned cropbox[4] = {0, 0, UINT_MAX, UINT_MAX};
   ZERO(imgdata);
+  memmgr.set_arena(flags & LIBRAW_OPTIONS_MEMARENA);
 
   cleargps(&imgdata.other.parsed_gps);
   ZERO(libraw_internal_data);
@@ -44,6 +45,7 @@ LibRaw::LibRaw(unsigned int flags) : memmgr(1024)
   dngnegative = NULL;
   dngimage = NULL;
   _x3f_data = NULL;
+  _crx_arena = NULL;
 
 #ifdef USE_RAWSPEED
   CameraMetaDataLR *camerameta =
@@ -62,6 +64,8 @@ LibRaw::LibRaw(unsigned int flags) : memmgr(1024)
           callbacks.interpolate_bayer_cb = callbacks.interpolate_xtrans_cb =
               callbacks.post_interpolate_cb = callbacks.pre_converttorgb_cb =
                   callbacks.post_converttorgb_cb = NULL;
+  callbacks.rawband_cb = NULL;
+  callbacks.rawbandcb_data = NULL;
 
   memmove(&imgdata.params.aber, &aber, sizeof(aber));
   memmove(&imgdata.params.gamm, &gamm, sizeof(gamm));
@@ -93,6 +97,7 @@ LibRaw::LibRaw(unsigned int flags) : memmgr(1024)
   imgdata.params.green_matching = 0;
   imgdata.rawparams.custom_camera_strings = 0;
   imgdata.rawparams.coolscan_nef_gamma = 1.0f;
+  imgdata.rawparams.rawband_rows = 0;
   imgdata.parent_class = this;
   imgdata.progress_flags = 0;
   imgdata.color.dng_levels.baseline_exposure = -999.f;
@@ -108,6 +113,7 @@ LibRaw::LibRaw(unsigned int flags) : memmgr(1024)
 LibRaw::~LibRaw()
 {
   recycle();
+  crxFreeArena();
   delete tls;
 #ifdef USE_RAWSPEED3
   if (_rawspeed3_handle)
@@ -140,25 +146,37 @@ void LibRaw::recycle()
       a = NULL;                                                                \
     }                                                                          \
   } while (0)
+  /* large buffers may be kept for reuse by the next file */
+  size_t maxkeep = size_t(imgdata.rawparams.keep_memory_mb) * 1024 * 1024;
+#define KEEP(a)                                                                \
+  do                                                                           \
+  {                                                                            \
+    if (a)                                                                     \
+    {                                                                          \
+      memmgr.retain(a, maxkeep);                                               \
+      a = NULL;                                                                \
+    }                                                                          \
+  } while (0)
 
-  FREE(imgdata.image);
+  KEEP(imgdata.image);
 
   // explicit cleanup of afdata allocations; entire array is zeroed below
   for (int i = 0; i < LIBRAW_AFDATA_MAXCOUNT; i++)
       FREE(MN.common.afdata[i].AFInfoData);
 
-  FREE(imgdata.thumbnail.thumb);
+  KEEP(imgdata.thumbnail.thumb);
   FREE(libraw_internal_data.internal_data.meta_data);
   FREE(libraw_internal_data.output_data.histogram);
   FREE(libraw_internal_data.output_data.oprof);
   FREE(imgdata.color.profile);
   FREE(imgdata.rawdata.ph1_cblack);
   FREE(imgdata.rawdata.ph1_rblack);
-  FREE(imgdata.rawdata.raw_alloc);
+  KEEP(imgdata.rawdata.raw_alloc);
   FREE(imgdata.idata.xmpdata);
 
   parseCR3_Free();
 
+#undef KEEP
 #undef FREE
 
   ZERO(imgdata.sizes);
@@ -166,6 +166,7 @@ void LibRaw::derror()
   if (!libraw_internal_data.unpacker_data.data_error &&
       libraw_internal_data.internal_data.input)
   {
+    getbits_sync();
     if (libraw_internal_data.internal_data.input->eof())
     {
       if (callbacks.data_cb)
@@ -275,6 +276,52 @@ void *LibRaw::calloc(size_t n, size_t t)
 }
 void LibRaw::free(void *p) { memmgr.free(p); }
 
+int LibRaw::get_memstats(libraw_memstats_t *m)
+{
+  if (!m)
+    return LIBRAW_UNSPECIFIED_ERROR;
+  m->current_bytes = memmgr.current_bytes();
+  m->peak_bytes = memmgr.max_bytes();
+  m->allocations = memmgr.allocations();
+  return LIBRAW_SUCCESS;
+}
+
+int LibRaw::rawband_height()
+{
+  int rows = imgdata.rawparams.rawband_rows
+                 ? (int)MIN(imgdata.rawparams.rawband_rows, 65534U)
+                 : LIBRAW_RAWBAND_DEFAULT_ROWS;
+  return (rows + 1) & ~1; /* keep CFA row pairs together */
+}
+
+void LibRaw::rawband_send(ushort *band, int row, int nrows)
+{
+  if (!callbacks.rawband_cb || nrows < 1)
+    return;
+  int rr = (*callbacks.rawband_cb)(callbacks.rawbandcb_data, band,
+                                   S.raw_pitch, row, nrows);
+  if (rr != 0)
+    throw LIBRAW_EXCEPTION_CANCELLED_BY_CALLBACK;
+}
+
+/* Pass raw_image rows [rawband_done, rows_done) to the callback in band sized
+   steps. Incomplete tail band is sent only if final is set */
+void LibRaw::rawband_flush(int rows_done, int final)
+{
+  int &done = libraw_internal_data.unpacker_data.rawband_done;
+  if (!callbacks.rawband_cb || !imgdata.rawdata.raw_image || !S.raw_pitch)
+    return;
+  int band = rawband_height();
+  rows_done = MIN(rows_done, (int)S.raw_height);
+  while (rows_done - done >= band || (final && rows_done > done))
+  {
+    int nrows = MIN(band, rows_done - done);
+    rawband_send(imgdata.rawdata.raw_image + size_t(done) * S.raw_pitch / 2,
+                 done, nrows);
+    done += nrows;
+  }
+}
+
 void LibRaw::recycle_datastream()
 {
   if (libraw_internal_data.internal_data.input &&
@@ -373,7 +373,11 @@ void LibRaw::x3f_dpq_interpolate_rg()
 
   for (int color = 0; color < 2; color++)
   {
-    for (int y = 2; y < (h - 2); y++)
+    int y;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(y)
+#endif
+    for (y = 2; y < (h - 2); y++)
     {
       uint16_t *row0 =
           &image[imgdata.sizes.raw_width * 3 * (y * 2) + color]; // dst[1]
@@ -400,16 +404,21 @@ void LibRaw::x3f_dpq_interpolate_rg()
 void LibRaw::x3f_dpq_interpolate_af(int xstep, int ystep, int scale)
 {
   unsigned short *image = (ushort *)imgdata.rawdata.color3_image;
-  for (int y = 0;
-       y < imgdata.rawdata.sizes.height + imgdata.rawdata.sizes.top_margin;
-       y += ystep)
+  // AF rows are ystep apart and only look scale rows up and down
+  int yend = imgdata.rawdata.sizes.height + imgdata.rawdata.sizes.top_margin,
+      iy;
+  if (yend > imgdata.rawdata.sizes.raw_height - scale + 1)
+    yend = imgdata.rawdata.sizes.raw_height - scale + 1;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(dynamic) default(shared) private(iy)
+#endif
+  for (iy = 0; iy < (yend + ystep - 1) / ystep; iy++)
   {
+    int y = iy * ystep;
     if (y < imgdata.rawdata.sizes.top_margin)
       continue;
     if (y < scale)
       continue;
-    if (y > imgdata.rawdata.sizes.raw_height - scale)
-      break;
     uint16_t *row0 = &image[imgdata.sizes.raw_width * 3 * y]; // Наша строка
     uint16_t *row_minus =
         &image[imgdata.sizes.raw_width * 3 * (y - scale)]; // Строка выше
@@ -488,10 +497,16 @@ void LibRaw::x3f_dpq_interpolate_af_sd(int xstart, int ystart, int xend,
                                        int scale)
 {
   unsigned short *image = (ushort *)imgdata.rawdata.color3_image;
-  for (int y = ystart; y <= yend && y < imgdata.rawdata.sizes.height +
-                                           imgdata.rawdata.sizes.top_margin;
-       y += ystep)
+  // AF rows are ystep apart and only touch rows y-scale .. y+scale
+  int ylast = MIN(yend, imgdata.rawdata.sizes.height +
+                            imgdata.rawdata.sizes.top_margin - 1),
+      ny = ylast >= ystart ? (ylast - ystart) / ystep + 1 : 0, iy;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(dynamic) default(shared) private(iy)
+#endif
+  for (iy = 0; iy < ny; iy++)
   {
+    int y = ystart + iy * ystep;
     uint16_t *row0 = &image[imgdata.sizes.raw_width * 3 * y]; // Наша строка
     uint16_t *row1 =
         &image[imgdata.sizes.raw_width * 3 * (y + 1)]; // Следующая строка
@@ -599,7 +614,11 @@ void LibRaw::x3f_load_raw()
     if (!strcasecmp(P1.make, "Polaroid") && !strcasecmp(P1.model, "x530"))
     {
       ushort(*src)[3] = (ushort(*)[3])data;
-      for (int p = 0; p < S.raw_height * S.raw_width; p++)
+      int p;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(p)
+#endif
+      for (p = 0; p < S.raw_height * S.raw_width; p++)
       {
         imgdata.rawdata.color3_image[p][0] = src[p][2];
         imgdata.rawdata.color3_image[p][1] = src[p][1];
@@ -614,8 +633,13 @@ void LibRaw::x3f_load_raw()
     {
       // Move quattro data in place
       // R/B plane
-      for (int prow = 0; prow < (int)TRU->x3rgb16.rows && prow < S.raw_height / 2;
-           prow++)
+      int prow, row;
+      const int prows = MIN((int)TRU->x3rgb16.rows, S.raw_height / 2);
+      const int rows = MIN((int)Q->top16.rows, (int)S.raw_height);
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(prow)
+#endif
+      for (prow = 0; prow < prows; prow++)
       {
         ushort(*destrow)[3] =
             (unsigned short(*)[3]) &
@@ -630,7 +654,10 @@ void LibRaw::x3f_load_raw()
           destrow[pcol * 2][1] = srcrow[pcol][1];
         }
       }
-      for (int row = 0; row < (int)Q->top16.rows && row < S.raw_height; row++)
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(row)
+#endif
+      for (row = 0; row < rows; row++)
       {
         ushort(*destrow)[3] =
             (unsigned short(*)[3]) &
@@ -842,7 +842,7 @@ typedef struct bit_state_s
 {
   uint8_t *next_address;
   uint8_t bit_offset;
-  uint8_t bits[8];
+  uint8_t byte;
 } bit_state_t;
 
 static void set_bit_state(bit_state_t *BS, uint8_t *address)
@@ -855,19 +855,14 @@ static uint8_t get_bit(bit_state_t *BS)
 {
   if (BS->bit_offset == 8)
   {
-    uint8_t byte = *BS->next_address;
-    int i;
-
-    for (i = 7; i >= 0; i--)
-    {
-      BS->bits[i] = byte & 1;
-      byte = byte >> 1;
-    }
-    BS->next_address++;
+    BS->byte = *BS->next_address++;
     BS->bit_offset = 0;
   }
+  BS->bit_offset++;
 
-  return BS->bits[BS->bit_offset++];
+  uint8_t bit = BS->byte >> 7;
+  BS->byte <<= 1;
+  return bit;
 }
 
 /* Decode use the TRUE algorithm */
@@ -912,6 +907,89 @@ static int32_t get_true_diff(bit_state_t *BS, x3f_hufftree_t *HTP)
   return diff;
 }
 
+/* The next 8 bits of the stream, without consuming them. Only touches
+   the byte at next_address, so callers check it is inside the data. */
+static uint8_t peek_byte(bit_state_t *BS)
+{
+  if (BS->bit_offset == 8)
+    return BS->next_address[0];
+  return BS->byte | (BS->next_address[0] >> (8 - BS->bit_offset));
+}
+
+/* Consume n <= 8 bits, leaving the same state n get_bit() calls would */
+static void skip_bits(bit_state_t *BS, int n)
+{
+  int left = 8 - BS->bit_offset;
+
+  if (n <= left)
+  {
+    BS->byte <<= n;
+    BS->bit_offset += n;
+    return;
+  }
+  BS->byte = *BS->next_address++ << (n - left);
+  BS->bit_offset = n - left;
+}
+
+/* TRUE codes are at most 8 bits long, so every byte value maps to the
+   code length (high byte) and leaf (low byte) it starts with. A code
+   running off a missing branch decodes as leaf 0, like get_true_diff();
+   a longer code is marked 0xffff and left to the tree walk. */
+static void true_diff_table(x3f_hufftree_t *HTP, uint16_t table[256])
+{
+  for (int v = 0; v < 256; v++)
+  {
+    x3f_huffnode_t *node = &HTP->nodes[0];
+    int len = 0;
+
+    while (node && (node->branch[0] != NULL || node->branch[1] != NULL) &&
+           len < 8)
+      node = node->branch[(v >> (7 - len++)) & 1];
+
+    if (node == NULL)
+      table[v] = len << 8;
+    else if (node->branch[0] != NULL || node->branch[1] != NULL)
+      table[v] = 0xffff;
+    else
+      table[v] = (len << 8) | (uint8_t)node->leaf;
+  }
+}
+
+static int32_t get_true_diff_fast(bit_state_t *BS, x3f_hufftree_t *HTP,
+                                  const uint16_t table[256], uint8_t *end)
+{
+  if (BS->next_address >= end)
+    return get_true_diff(BS, HTP);
+
+  uint16_t code = table[peek_byte(BS)];
+  if (code == 0xffff)
+    return get_true_diff(BS, HTP);
+  skip_bits(BS, code >> 8);
+
+  uint8_t bits = code & 0xff;
+  uint8_t first_bit;
+  int32_t diff;
+
+  if (bits == 0)
+    return 0;
+  if (bits > 8 || BS->next_address >= end)
+  {
+    diff = first_bit = get_bit(BS);
+    for (int i = 1; i < bits; i++)
+      diff = (diff << 1) + get_bit(BS);
+  }
+  else
+  {
+    diff = peek_byte(BS) >> (8 - bits);
+    first_bit = diff >> (bits - 1);
+    skip_bits(BS, bits);
+  }
+
+  if (first_bit == 0)
+    diff -= (1 << bits) - 1;
+  return diff;
+}
+
 /* This code (that decodes one of the X3F color planes, really is a
    decoding of a compression algorithm suited for Bayer CFA data. In
    Bayer CFA the data is divided into 2x2 squares that represents
@@ -923,10 +1001,38 @@ static int32_t get_true_diff(bit_state_t *BS, x3f_hufftree_t *HTP)
 
 /* TODO: write more about the compression */
 
-static void true_decode_one_color(x3f_image_data_t *ID, int color)
+/* Output area and plane size for one color; NULL if they do not match */
+static x3f_area16_t *true_plane_area(x3f_image_data_t *ID, int color,
+                                     uint32_t *rows, uint32_t *cols)
 {
-  x3f_true_t *TRU = ID->tru;
   x3f_quattro_t *Q = ID->quattro;
+  x3f_area16_t *area = &ID->tru->x3rgb16;
+
+  *rows = ID->rows;
+  *cols = ID->columns;
+
+  if (ID->type_format == X3F_IMAGE_RAW_QUATTRO ||
+      ID->type_format == X3F_IMAGE_RAW_SDQ ||
+      ID->type_format == X3F_IMAGE_RAW_SDQH ||
+      ID->type_format == X3F_IMAGE_RAW_SDQH2)
+  {
+    *rows = Q->plane[color].rows;
+    *cols = Q->plane[color].columns;
+
+    if (Q->quattro_layout && color == 2)
+      area = &Q->top16;
+  }
+
+  if (*rows != area->rows || *cols < area->columns)
+    return NULL;
+  return area;
+}
+
+/* Decode one plane to dst, stride values apart */
+static void true_decode_one_color(x3f_image_data_t *ID, int color,
+                                  uint16_t *dst, int stride)
+{
+  x3f_true_t *TRU = ID->tru;
   uint32_t seed = TRU->seed[color]; /* TODO : Is this correct ? */
   int row;
 
@@ -934,11 +1040,15 @@ static void true_decode_one_color(x3f_image_data_t *ID, int color)
   bit_state_t BS;
 
   int32_t row_start_acc[2][2];
-  uint32_t rows = ID->rows;
-  uint32_t cols = ID->columns;
-  x3f_area16_t *area = &TRU->x3rgb16;
-  uint16_t *dst = area->data + color;
+  uint32_t rows, cols;
+  x3f_area16_t *area = true_plane_area(ID, color, &rows, &cols);
+  if (!area)
+    throw LIBRAW_EXCEPTION_IO_CORRUPT;
+
+  uint8_t *end = (uint8_t *)ID->data + ID->data_size;
+  uint16_t table[256];
 
+  true_diff_table(tree, table);
   set_bit_state(&BS, TRU->plane_address[color]);
 
   row_start_acc[0][0] = seed;
@@ -946,27 +1056,6 @@ static void true_decode_one_color(x3f_image_data_t *ID, int color)
   row_start_acc[1][0] = seed;
   row_start_acc[1][1] = seed;
 
-  if (ID->type_format == X3F_IMAGE_RAW_QUATTRO ||
-      ID->type_format == X3F_IMAGE_RAW_SDQ ||
-      ID->type_format == X3F_IMAGE_RAW_SDQH ||
-      ID->type_format == X3F_IMAGE_RAW_SDQH2)
-  {
-    rows = Q->plane[color].rows;
-    cols = Q->plane[color].columns;
-
-    if (Q->quattro_layout && color == 2)
-    {
-      area = &Q->top16;
-      dst = area->data;
-    }
-  }
-  else
-  {
-  }
-
-  if (rows != area->rows || cols < area->columns)
-    throw LIBRAW_EXCEPTION_IO_CORRUPT;
-
   for (row = 0; row < (int)rows; row++)
   {
     int col;
@@ -976,7 +1065,7 @@ static void true_decode_one_color(x3f_image_data_t *ID, int color)
     for (col = 0; col < (int)cols; col++)
     {
       bool_t odd_col = col & 1;
-      int32_t diff = get_true_diff(&BS, tree);
+      int32_t diff = get_true_diff_fast(&BS, tree, table, end);
       int32_t prev = col < 2 ? row_start_acc[odd_row][odd_col] : acc[odd_col];
       int32_t value = prev + diff;
 
@@ -989,7 +1078,7 @@ static void true_decode_one_color(x3f_image_data_t *ID, int color)
         continue;
 
       *dst = value;
-      dst += area->channels;
+      dst += stride;
     }
   }
 }
@@ -998,12 +1087,56 @@ static void true_decode(x3f_info_t * /*I*/, x3f_directory_entry_t *DE)
 {
   x3f_directory_entry_header_t *DEH = &DE->header;
   x3f_image_data_t *ID = &DEH->data_subsection.image_data;
-  int color;
-
-  for (color = 0; color < 3; color++)
+  x3f_area16_t *rgb = &ID->tru->x3rgb16;
+  uint16_t *buf[3] = {NULL, NULL, NULL};
+  int color, planes, row;
+  uint32_t rows, cols;
+
+  /* Each plane is its own bit stream written to its own channel, so the
+     planes are decoded at once. The size checks run first and in plane
+     order, so a bad plane still leaves the ones after it undecoded. */
+  for (planes = 0; planes < 3 && true_plane_area(ID, planes, &rows, &cols);
+       planes++)
+    ;
+#ifdef LIBRAW_USE_OPENMP
+  /* Channels of the interleaved x3rgb16 share cache lines: decode them to
+     separate planes and interleave these afterwards */
+  for (color = 0; planes > 1 && color < planes; color++)
+    if (true_plane_area(ID, color, &rows, &cols) == rgb)
+      buf[color] = (uint16_t *)malloc(sizeof(uint16_t) * rgb->rows *
+                                      rgb->columns);
+#pragma omp parallel for schedule(static, 1) default(shared) private(color)
+#endif
+  for (color = 0; color < planes; color++)
   {
-    true_decode_one_color(ID, color);
+    x3f_area16_t *area = true_plane_area(ID, color, &rows, &cols);
+    if (buf[color])
+      true_decode_one_color(ID, color, buf[color], 1);
+    else
+      true_decode_one_color(ID, color,
+                            area == rgb ? area->data + color : area->data,
+                            area->channels);
   }
+  if (buf[0] || buf[1] || buf[2])
+  {
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for default(shared) private(color)
+#endif
+    for (row = 0; row < (int)rgb->rows; row++)
+      for (color = 0; color < 3; color++)
+        if (buf[color])
+        {
+          uint16_t *src = buf[color] + (size_t)row * rgb->columns;
+          uint16_t *dst =
+              rgb->data + (size_t)row * rgb->columns * rgb->channels + color;
+          for (uint32_t col = 0; col < rgb->columns; col++)
+            dst[col * rgb->channels] = src[col];
+        }
+    for (color = 0; color < 3; color++)
+      free(buf[color]);
+  }
+  if (planes < 3)
+    throw LIBRAW_EXCEPTION_IO_CORRUPT;
 }
 
 /* Decode use the huffman tree */
@@ -1085,23 +1218,53 @@ static void huffman_decode_row(x3f_info_t * /*I*/, x3f_directory_entry_t *DE,
   }
 }
 
-static void huffman_decode(x3f_info_t *I, x3f_directory_entry_t *DE, int bits)
+/* Rows start at their own row_offsets[] entry, so they are decoded in
+   parallel; a corrupt row is reported once all threads are done */
+static void huffman_decode_rows(x3f_info_t *I, x3f_directory_entry_t *DE,
+                                int bits, int offset, int *minimum)
 {
-  x3f_directory_entry_header_t *DEH = &DE->header;
-  x3f_image_data_t *ID = &DEH->data_subsection.image_data;
+  x3f_image_data_t *ID = &DE->header.data_subsection.image_data;
+  int row, failed = 0;
 
-  int row;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel default(shared)
+#endif
+  {
+    int rowmin = *minimum;
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp for schedule(static) private(row)
+#endif
+    for (row = 0; row < (int)ID->rows; row++)
+    {
+      try
+      {
+        huffman_decode_row(I, DE, bits, row, offset, &rowmin);
+      }
+      catch (...)
+      {
+        failed = 1;
+      }
+    }
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp critical
+#endif
+    *minimum = MIN(*minimum, rowmin);
+  }
+  if (failed)
+    throw LIBRAW_EXCEPTION_IO_CORRUPT;
+}
+
+static void huffman_decode(x3f_info_t *I, x3f_directory_entry_t *DE, int bits)
+{
   int minimum = 0;
   int offset = legacy_offset;
 
-  for (row = 0; row < (int)ID->rows; row++)
-    huffman_decode_row(I, DE, bits, row, offset, &minimum);
+  huffman_decode_rows(I, DE, bits, offset, &minimum);
 
   if (auto_legacy_offset && minimum < 0)
   {
     offset = -minimum;
-    for (row = 0; row < (int)ID->rows; row++)
-      huffman_decode_row(I, DE, bits, row, offset, &minimum);
+    huffman_decode_rows(I, DE, bits, offset, &minimum);
   }
 }
 
@@ -1190,10 +1353,25 @@ static void simple_decode(x3f_info_t *I, x3f_directory_entry_t *DE, int bits,
   x3f_directory_entry_header_t *DEH = &DE->header;
   x3f_image_data_t *ID = &DEH->data_subsection.image_data;
 
-  int row;
+  int row, failed = 0;
 
+  /* rows are fixed-size records, so they are decoded in parallel */
+#ifdef LIBRAW_USE_OPENMP
+#pragma omp parallel for schedule(static) default(shared) private(row)
+#endif
   for (row = 0; row < (int)ID->rows; row++)
-    simple_decode_row(I, DE, bits, row, row_stride);
+  {
+    try
+    {
+      simple_decode_row(I, DE, bits, row, row_stride);
+    }
+    catch (...)
+    {
+      failed = 1;
+    }
+  }
+  if (failed)
+    throw LIBRAW_EXCEPTION_IO_CORRUPT;
 }
 
 /* --------------------------------------------------------------------- */
@@ -120,8 +120,10 @@ int main([[maybe_unused]] int argc, char *argv[]) {
     image_paths.push_back(file.path());
   }
 
-  // Create LibRaw ImageProcessor
+  // Create LibRaw ImageProcessor, shared by all images
   LibRaw ImageProcessor(0);
+  // Keep raw and thumbnail buffers between files
+  ImageProcessor.imgdata.rawparams.keep_memory_mb = 512;
 
   // Get total number of files to process
   const int file_count = static_cast<int>(image_paths.size());
@@ -159,7 +161,7 @@ int main([[maybe_unused]] int argc, char *argv[]) {
     }
 
     ImageData *image_data =
-        new ImageData(image_name, image_path, output_directory);
+        new ImageData(image_name, image_path, output_directory, ImageProcessor);
     try {
       image_data->get_image_number();
     } catch (std::exception &e) {
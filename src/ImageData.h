@@ -54,11 +54,12 @@ public:
   std::basic_string<char> name;
   std::string path;
 
-  ImageData() = default;
   // Will throw error if image name doesn't end with numbers
+  // ImageProcessor is shared between images, so its buffers get reused
   ImageData(std::basic_string<char> _name, std::string _path,
-            const std::string &output_path)
-      : name(std::move(_name)), path(std::move(_path)) {
+            const std::string &output_path, LibRaw &processor)
+      : name(std::move(_name)), path(std::move(_path)),
+        ImageProcessor(processor) {
 
     // Set full path
     full_path = output_path + "/full/" + name + "-full.jpg";
@@ -103,7 +104,7 @@ private:
   std::string gallery_path;
   std::string thumbnail_path;
 
-  LibRaw ImageProcessor;
+  LibRaw &ImageProcessor;
 
   void write_thumbnail(ImageType thumbnail_index) {
     std::string output_file;